@@ -48,6 +48,9 @@ struct packet
 	};
 	static_assert(sizeof(pdu) == sizeof(rawpdu), "");
 
+	// kernel RX timestamp of received packets in ns (see buf_desc<P>::tstamp), not sent
+	uint64_t tstamp;
+
 	inline uint64_t* begin();
 	inline uint64_t* end();
 
@@ -62,7 +65,7 @@ struct packet
 		return tmp;
 	}
 
-	packet() : pid(0xDEAD), len(1) // minimum length
+	packet() : pid(0xDEAD), len(1), tstamp(0) // minimum length
 	{}
 } __attribute__((__packed__));
 
@@ -42,11 +42,22 @@ struct arq_ackframe {
 };
 static_assert(sizeof(struct arq_ackframe) == 4, "");
 
+/* SACK frame (WITH_SACK): an arq_frame of type PTYPE_SACK with SEQ_NONE and P::SACK_WORDS words, bit i
+ * of the payload (word i/64, LSB first) reports frame ACK+1+i as received out of order.
+ * Without a sequence number it is taken for a plain ACK by peers which do not know about SACK.*/
+
 struct arq_resetframe {
 	uint32_t magic_word;
 };
 static_assert(sizeof(struct arq_resetframe) == 4, "");
 
+/* reset frame offering protocol extensions (CFG_FEATURE_*), FPGAs identify reset frames by the magic word */
+struct arq_resetframe_ext {
+	uint32_t magic_word;
+	uint32_t features;
+};
+static_assert(sizeof(struct arq_resetframe_ext) == 8, "");
+
 
 /**** FUNCS USED BY SCTP LAYER ****/
 
@@ -125,6 +136,11 @@ static inline void sctpreset_init (struct arq_resetframe *packet) {
 	packet->magic_word = htonl(HW_HOSTARQ_MAGICWORD);
 }
 
+static inline void sctpreset_init_ext (struct arq_resetframe_ext *packet, __u32 features) {
+	packet->magic_word = htonl(HW_HOSTARQ_MAGICWORD);
+	packet->features = htonl(features);
+}
+
 
 template<typename AF>
 __attribute__((always_inline)) static inline __u32 sctpsomething_get_size (AF* packet, size_t nread) {
@@ -111,6 +111,12 @@ void atomic_write (volatile __s32 *ptr, __s32 new_val);
 /*Should not be here MOVE IT TO OTHER LOC OR REMOVE IT, WHEN COMP FOR KERNELSPACE*/
 void cpu_relax (void);
 
+/*Monotonic clock in ns to bound busy waiting loops (vDSO, no syscall)*/
+__u64 spin_clock (void);
+
+/*Clock of the protocol in us: window timestamps, ACK delays and timeouts (CLOCK_MONOTONIC_RAW, vDSO, not slewed by NTP)*/
+__u64 sctp_clock (void);
+
 /*A fast blocking mutex can be implemented with the following functions (Ulrich Drepper)*/
 void mutex_init (volatile struct drepper_mutex *dm);
 
@@ -0,0 +1,93 @@
+#pragma once
+/* Congestion control of the TX window (WITH_CONGAV)
+ * The window keeps the state of its controller and calls it: new frames may only be sent while
+ * can_send agrees, on_ack reports cumulatively acknowledged frames, on_loss a frame resent after
+ * duplicate ACKs and on_timeout frames resent after their timeout. A loss episode lasts until the frames
+ * in flight at its start are acknowledged (win->flag is set meanwhile); the window reports only its first
+ * loss and no ACKs during an episode.
+ * Windows count in frames. The controller is selected at core start by name from the environment
+ * variable CC_ENV (default: the first one, "aimd").
+ * Controllers:
+ *   aimd  - slow start, then grows by the free fraction of the window per ACK; a loss stops new frames
+ *           until the window is empty and restarts with one frame (the original WITH_CONGAV behaviour)
+ *   cubic - slow start, then the window follows a cubic function of the time since the last loss
+ *           (RFC 8312, not slower than Reno); a loss reported by duplicate ACKs reduces it to 70%, after
+ *           a timeout it restarts with one frame and slow start up to 70%*/
+
+#include <linux/types.h>
+#include <stddef.h>
+
+#include "sctrltp/build-config.h"
+
+namespace sctrltp {
+
+/* environment variable naming the controller of a core */
+#define CC_ENV              "SCTRLTP_CC"
+
+/* indices into sctp_cc_algos */
+#define SCTP_CC_AIMD        0
+#define SCTP_CC_CUBIC       1
+#define SCTP_CC_NUM         2
+
+/* state of the controller of a window (shared memory, one cache line) */
+struct sctp_cc_state {
+	__u32   algo;           /* index into sctp_cc_algos                                        */
+	__u32   cwnd;           /* frames which may be in flight                                   */
+	__u32   ssthresh;       /* slow start below, congestion avoidance above                    */
+	__u32   max_wsize;      /* cwnd never grows beyond                                         */
+	__u32   cnt;            /* aimd: percent of a frame gained; cubic: ACKs towards next frame */
+	__u32   w_max;          /* cubic: cwnd at the last loss (frames * CC_SCALE)                */
+	__u32   w_est;          /* cubic: window Reno would have (frames * CC_SCALE)               */
+	__u32   growing;        /* cubic: epoch and k are valid                                    */
+	__u64   epoch;          /* cubic: start of the growth since the last loss (us)             */
+	__u64   k;              /* cubic: time from epoch until w_max is reached again (us)        */
+	__u8    pad[L1D_CLS-48];
+};
+static_assert(sizeof(struct sctp_cc_state) == L1D_CLS, "");
+
+/* fixed point of fractional windows */
+#define CC_SCALE            1024
+
+struct sctp_cc {
+	char const *name;
+	/* sets up cc->cwnd, cc->ssthresh, ... for a new connection (cc->algo and cc->max_wsize are set) */
+	void (*init) (struct sctp_cc_state *cc);
+	/* returns 1 if another frame may be sent with inflight frames unacknowledged */
+	__u8 (*can_send) (struct sctp_cc_state const *cc, __u32 inflight);
+	/* nacked frames were acknowledged at currtime (us) */
+	void (*on_ack) (struct sctp_cc_state *cc, __u32 nacked, __u64 currtime);
+	/* a frame was lost, remote reported it by duplicate ACKs */
+	void (*on_loss) (struct sctp_cc_state *cc, __u64 currtime);
+	/* frames were resent after their retransmission timeout */
+	void (*on_timeout) (struct sctp_cc_state *cc, __u64 currtime);
+};
+
+extern struct sctp_cc const sctp_cc_algos[SCTP_CC_NUM];
+
+/* returns the index of the controller called name, SC_INVAL if there is none */
+__s32 cc_find (char const *name);
+
+/* sets up cc for controller algo and windows of up to max_wsize frames */
+void cc_init (struct sctp_cc_state *cc, __u32 algo, __u32 max_wsize);
+
+static inline __u8 cc_can_send (struct sctp_cc_state const *cc, __u32 inflight)
+{
+	return sctp_cc_algos[cc->algo].can_send (cc, inflight);
+}
+
+static inline void cc_on_ack (struct sctp_cc_state *cc, __u32 nacked, __u64 currtime)
+{
+	sctp_cc_algos[cc->algo].on_ack (cc, nacked, currtime);
+}
+
+static inline void cc_on_loss (struct sctp_cc_state *cc, __u64 currtime)
+{
+	sctp_cc_algos[cc->algo].on_loss (cc, currtime);
+}
+
+static inline void cc_on_timeout (struct sctp_cc_state *cc, __u64 currtime)
+{
+	sctp_cc_algos[cc->algo].on_timeout (cc, currtime);
+}
+
+} // namespace sctrltp
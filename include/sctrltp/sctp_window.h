@@ -1,6 +1,6 @@
 #pragma once
 /*
- * Use -DWITH_CONGAV to enable congestion avoidance
+ * Use -DWITH_CONGAV to enable congestion avoidance (see sctp_cc.h)
  *
  * ATTENTION: This version needs locking by callers of this functions!
  * */
@@ -10,6 +10,7 @@
 
 #include "packets.h"
 #include "sctp_atomic.h"
+#include "sctp_cc.h"
 #include "us_sctp_defs.h"
 
 #define SCTP_TXWIN  0
@@ -24,25 +25,30 @@ struct sctp_window {
 	__u32   pad0[L1D_CLS/4-1];
 	__u32	high_seq;				/*Sequencenr of next Packet to be checked in win*/
 	__u32   pad1[L1D_CLS/4-1];
-	__u32   flag;                   /*Is set to 1 if retransmission ocurred and unset by congestion avoidance algortihm*/
+	__u32   flag;                   /*Is set to 1 if retransmission ocurred, until the frames in flight then are acknowledged*/
 
 	sctp_internal<P> *frames;	/*Pointer to buffer holding all frames (sorted by SEQ)*/
-	__u32   cur_wsize;              /*Vars for slow start and congestion avoidance*/
-	__u32   ss_thresh;
-	__u32	max_frames;			    /*How many frames can be in frames buffer?*/
+	__u64   *acked;                 /*Bitmap by SEQ behind frames: RXWIN frame held, TXWIN frame acknowledged*/
+	__u64   *busy;                  /*Bitmap by SEQ behind acked: TXWIN frame in flight (req valid)*/
+	__u32   recover;                /*high_seq when flag was set, the loss episode ends when low_seq gets there*/
+	__u32	max_frames;			    /*How many frames can be in frames buffer? (power of 2)*/
+	__u32   mask;                   /*max_frames - 1, SEQ arithmetic wraps by masking*/
 	__u32	max_wsize;				/*How large can the distance between low_seq and high_seq ever grow?*/
 	__u32   side;                   /*Defines behaviour of functions (A Senderwindow is slightly different from a Receiverwin)*/
-	__u32   pad2[L1D_CLS/4-6-PTR_SIZE/4-1]; /* ptr alignment requires 64 bits */
-
+	__u32   rs_head;                /*Resend list of TXWIN: unacknowledged frames by time of their last transmission,*/
+	__u32   rs_tail;                /*so they time out from the head (SEQ_NONE if empty)*/
+	__u32   pad2[L1D_CLS/4-8-3*PTR_SIZE/4-1]; /* ptr alignment requires 64 bits */
+	struct sctp_cc_state cc;        /*Congestion controller of TXWIN (WITH_CONGAV)*/
 };
 #define PARAMETERISATION(Name, name)                                                               \
 	static_assert(offsetof(sctp_window<Name>, high_seq) == (2 * L1D_CLS), "");                     \
 	static_assert(offsetof(sctp_window<Name>, flag) == (3 * L1D_CLS), "");                         \
-	static_assert(sizeof(sctp_window<Name>) == (4 * L1D_CLS), "");
+	static_assert(offsetof(sctp_window<Name>, cc) == (4 * L1D_CLS), "");                           \
+	static_assert(sizeof(sctp_window<Name>) == (5 * L1D_CLS), "");
 #include "sctrltp/parameters.def"
 
-/*Initializes sliding window 
- *Returns 0 on success otherwise a negative value*/
+/*Initializes sliding window (max_fr has to be a power of 2, frames and bitmaps are allocated at once: free frames)
+ *Returns 1 on success otherwise a negative value*/
 template <typename P>
 __s8 win_init(sctp_window<P> *win, __u32 max_fr, __u32 max_ws, __u8 side);
 
@@ -56,18 +62,66 @@ void win_reset(sctp_window<P> *win);
 template <typename P>
 __s32 new_frame_tx (sctp_window<P> *win, arq_frame<P> *new_frame, __u64 currtime);
 
-/* Inserts frame into RXWIN if seq valid (and in window) returning slides and content of frames checked out*/
+/* Inserts frame into RXWIN if seq valid (and in window) returning slides and the frames checked out*/
+template <typename P>
+__s32 new_frame_rx (sctp_window<P> *win, arq_frame<P> *in, arq_frame<P> **out);
+
+/* Inserts a burst of frames into RXWIN and slides only once afterwards
+ * Frames taken by the window are set to NULL in the in array, all others were out of window
+ * Returns number of slides, the frames checked out are loaded into out (in order)*/
 template <typename P>
-__s32 new_frame_rx (sctp_window<P> *win, arq_frame<P> *in, sctp_internal<P> *out);
+__s32 new_frames_rx (sctp_window<P> *win, arq_frame<P> **in, __u32 num, arq_frame<P> **out);
 
 /*Marks the corresponding frame (equal sequencenr and nathannr) with the incoming packet
  *Returns n>0 if window was slided n times otherwise 0 (on error -1)
- *If slide was performed buffer given by out is loaded with data to pass to user*/
+ *If slide was performed out is loaded with the frames to pass to user (in order) and last (unless NULL)
+ *with the entry of the newest one, its zc/zc_id telling about the latest zerocopy send of all of them*/
+template <typename P>
+__s32 mark_frame (sctp_window<P> *win, __u32 rACK, arq_frame<P> **out, sctp_internal<P> *last, __u64 currtime);
+
+/*Notes that the given frames (in window) were sent zerocopy, the kernel references them until zc_id
+ *completed (reported in last by mark_frame, so the caller can hold them back)*/
+template <typename P>
+void mark_zerocopy (sctp_window<P> *win, arq_frame<P> **frames, __u32 num, __u32 zc_id);
+
+/*Stores the kernel TX timestamps of the given frames (if still in window)*/
+template <typename P>
+void mark_tstamp (sctp_window<P> *win, arq_frame<P> **frames, __u64 const *ts, __u32 num);
+
+/*Fills bitmap (P::SACK_WORDS words, big endian like the payload of a SACK frame) with the frames
+ *RXWIN holds out of order beyond ack (bit i: frame ack+1+i)
+ *Returns the number of frames held, 0 if there is nothing to report*/
+template <typename P>
+__u32 sack_bitmap (sctp_window<P> *win, __u32 ack, __u64 *bitmap);
+
+/*Marks the frames of TXWIN which a SACK frame (ack and its nwords of bitmap) reports as received,
+ *resend_frame skips them (they are checked out by mark_frame once the cumulative ACK passes them)
+ *Returns the number of frames newly marked*/
+template <typename P>
+__u32 mark_sack (sctp_window<P> *win, __u32 ack, __u64 const *bitmap, __u32 nwords);
+
+/*Gives back frame seq for an immediate retransmission if it is in window and not acknowledged (fast retransmit),
+ *its resend timeout restarts at currtime
+ *Returns 1 if it was copied into resend, otherwise 0*/
+template <typename P>
+__s32 fast_resend_frame (sctp_window<P> *win, __u32 seq, sctp_internal<P> *resend, __u64 currtime);
+
+/*Gives back up to max of the frames whose last transmission is rto or more before currtime (oldest first) and
+ *restarts their timeout; only expired frames are touched (frames selectively acknowledged are not resent)*/
+template <typename P>
+__s32 resend_frame (sctp_window<P> *win, sctp_internal<P> *resend, __u32 max, __u64 rto, __u64 currtime);
+
+/*Restarts the timeout of the frames resend_frame would give back, without resending them
+ *Returns their number*/
+template <typename P>
+__u32 resend_restart (sctp_window<P> *win, __u64 rto, __u64 currtime);
+
+/*Returns the time the first frame will be due for resend_frame with rto, TIME_NONE if no frame waits for its ACK*/
 template <typename P>
-__s32 mark_frame (sctp_window<P> *win, __u32 rACK, sctp_internal<P> *out);
+__u64 resend_deadline (sctp_window<P> const *win, __u64 rto);
 
-/*Compares time field of packet(s) with currtime and gives them back if difference exceeds rto*/
+/*Returns 1 if the remote acknowledged frames up to rACK which mark_frame did not take out of the window yet*/
 template <typename P>
-__s32 resend_frame (sctp_window<P> *win, sctp_internal<P> *resend, __u64 rto, __u64 currtime);
+__u8 ack_pending (sctp_window<P> *win, __u32 rACK);
 
 } // namespace sctrltp
@@ -12,6 +12,7 @@
 #define TYPLEN_SIZE          4 /* in bytes */
 
 #define PDU_SIZE          (MTU - ETH_HEADER_SIZE - ARQ_HEADER_SIZE)
+#define WIRE_OVERHEAD       (ETH_HEADER_SIZE + 20 + 8 + 4 + 8 + 12) /* IPv4, UDP, FCS, preamble and gap of a datagram on the wire (in bytes) */
 #define WORD_SIZE            8 /* 64-bit words! */
 
 
@@ -20,6 +21,7 @@
 #define PTYPE_CFG_TYPE     0x8002 /* configure fpga */
 #define PTYPE_SENDDUMMY    0x8003 /* set fpga to send dummy data */
 #define PTYPE_STATS        0x8004 /* fpga stats module */
+#define PTYPE_SACK         0x8005 /* selective acknowledgement (see packets.h) */
 #define PTYPE_PERFTEST     0x8006 /* set fpga to send data */
 #define PTYPE_DUMMYDATA0   0x0000
 #define PTYPE_DUMMYDATA1   0x0001
@@ -29,6 +31,15 @@
 
 
 #define CFG_SIZE                      3
+/* word of the CFG frame after the CFG_SIZE settings: length of the bitfile info (low 32 bits) and
+ * the protocol extensions the FPGA accepted from the reset frame's offer (high 32 bits) */
+#define CFG_INFO                      CFG_SIZE
+#define CFG_FEATURES_SHIFT            32
+#define CFG_FEATURE_SACK              0x1 /* selective acknowledgements (SACK frames, see packets.h) */
+
+/* SEQ of frames outside the sequence space (SACK frames) */
+#define SEQ_NONE             0xFFFFFFFF
+#define TIME_NONE            0xFFFFFFFFFFFFFFFFULL /* no deadline */
 
 #define HW_HOSTARQ_MAGICWORD 0xABABABAB
 
@@ -39,7 +50,7 @@ typedef std::unordered_set<packetid_t> unique_queue_set_t;
 
 template<
 	size_t I_MAX_WINSIZ = 128,   /* Can be specified in the range of 1 till (MAX_NRFRAMES-1)/2 (compile-time check exists) */
-	size_t I_MAX_NRFRAMES = 256, /* Maximum number of frames in buffer equals maximum SEQ number + 1 */
+	size_t I_MAX_NRFRAMES = 256, /* Maximum number of frames in buffer equals maximum SEQ number + 1 (power of 2) */
 	size_t I_WIRESPEED = 125,    /* in 10^6 bytes/sec (because we calculate in us) */
 	size_t I_MAX_PDUWORDS = 180, /* could be (PDU_SIZE/8)? */
 	size_t I_ALLOC_BUF_FACTOR = 4 /* heuristic factor for tx and rc buffer size  */
@@ -49,6 +60,7 @@ struct Parameters
 	constexpr static size_t MAX_WINSIZ = I_MAX_WINSIZ;
 	constexpr static size_t MAX_NRFRAMES = I_MAX_NRFRAMES;
 	static_assert((MAX_WINSIZ * 2) <= MAX_NRFRAMES, "reduce window size to max. seq number / 2 => ((MAX_NRFRAMES-1)/2)!");
+	static_assert((MAX_NRFRAMES & (MAX_NRFRAMES - 1)) == 0, "SEQ numbers wrap by masking, MAX_NRFRAMES has to be a power of 2!");
 	constexpr static size_t WIRESPEED = I_WIRESPEED;
 	constexpr static size_t MAX_PDUWORDS = I_MAX_PDUWORDS;
 
@@ -61,14 +73,36 @@ struct Parameters
 	constexpr static size_t TX_BUFSIZE = ALLOCTX_BUFSIZE;
 	constexpr static size_t RX_BUFSIZE = ALLOCRX_BUFSIZE;
 
-	constexpr static size_t MIN_RTO = ((I_MAX_WINSIZ * PDU_SIZE) / I_WIRESPEED) / 2; /* us */
-	constexpr static size_t MAX_RTO = MIN_RTO;
-	constexpr static size_t DELAY_ACK = 500;
+	constexpr static size_t INIT_RTO = ((I_MAX_WINSIZ * PDU_SIZE) / I_WIRESPEED) / 2; /* us, retransmission timeout until the first RTT sample (fixed without WITH_RTTADJ) */
+	constexpr static size_t MIN_RTO = 100;         /* us, bounds of the estimated RTO and its backoff (WITH_RTTADJ) */
+	constexpr static size_t MAX_RTO = 100 * 1000;  /* us */
+	constexpr static size_t DELAY_ACK = 500; /*us a frame waits for its ACK at most (frames arriving in a trickle)*/
+	constexpr static size_t ACK_EVERY = (MAX_WINSIZ + 7) / 8; /*frames received in sequence which are acknowledged at once (also after half the window)*/
 	constexpr static size_t RESET_TIMEOUT = 2000*1000; /*in us*/
 
-	constexpr static size_t TO_RES = 100; /*Timeout resolution in microseconds*/
+	constexpr static size_t TO_RES = 100; /*Timeout resolution in microseconds (RTT variation below does not count for the RTO)*/
+	constexpr static size_t RX_BATCH = 32; /*maximum number of datagrams fetched per socket read*/
+	constexpr static size_t TX_BURST = 32; /*maximum number of frames handed to the socket at once*/
+	/*WITH_BUSY_POLL: time in us each stage spins before it goes to sleep (0 = don't spin)*/
+	constexpr static size_t BUSY_POLL_RX = 50;   /*RX on the socket (also kernel side SO_BUSY_POLL)*/
+	constexpr static size_t BUSY_POLL_TX = 50;   /*TX on tx_queue and remote ACK*/
+	constexpr static size_t BUSY_POLL_USER = 50; /*users in recv_buf on their rx queue*/
 	constexpr static size_t MAX_TRANS = 10000; /*maximum number of transmission till warning!!!*/
+	/*After a timeout RESEND resends the oldest frame alone, further expired frames follow in slots RETX_GAP us
+	 *apart, RETX_BURST frames each, until an ACK of the remote shows progress beyond the frames resent*/
+	constexpr static size_t RETX_BURST = 8;
+	constexpr static size_t RETX_GAP = TO_RES;
+	constexpr static size_t DUPACK_THRESH = 3; /*repeated pure ACKs after which the frame following them is resent at once (0 = no fast retransmit)*/
+	constexpr static size_t SACK_WORDS = (MAX_WINSIZ + 63) / 64; /*payload of a SACK frame, one bit per frame of the window*/
+	/*WITH_PACING: token bucket in front of the socket (overridden by PACE_RATE_ENV/PACE_BURST_ENV at core start)*/
+	constexpr static size_t PACE_RATE = WIRESPEED;  /*bytes per us on the wire (0 = don't pace)*/
+	constexpr static size_t PACE_BURST = 16 * MTU;  /*bytes sent back to back at most*/
 	static_assert(DELAY_ACK > TO_RES);
+	static_assert(ACK_EVERY >= 1);
+	static_assert((TO_RES <= MIN_RTO) && (MIN_RTO <= INIT_RTO) && (INIT_RTO <= MAX_RTO));
+	static_assert(SACK_WORDS <= MAX_PDUWORDS);
+	static_assert((RETX_BURST >= 1) && (RETX_GAP >= 1));
+	static_assert(PACE_BURST >= MTU + WIRE_OVERHEAD, "token bucket must hold a full frame");
 };
 
 typedef Parameters<> ParametersFcp;
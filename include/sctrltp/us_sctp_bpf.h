@@ -0,0 +1,26 @@
+#pragma once
+/* minimal helpers for loading eBPF programs without libbpf (AF_XDP steering program, socket filter) */
+
+#include <linux/bpf.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sctrltp {
+
+static inline long sys_bpf (int cmd, union bpf_attr *attr)
+{
+	return syscall (__NR_bpf, cmd, attr, sizeof(union bpf_attr));
+}
+
+static inline struct bpf_insn insn (__u8 code, __u8 dst, __u8 src, __s16 off, __s32 imm)
+{
+	struct bpf_insn i;
+	i.code = code;
+	i.dst_reg = dst;
+	i.src_reg = src;
+	i.off = off;
+	i.imm = imm;
+	return i;
+}
+
+} // namespace sctrltp
@@ -4,7 +4,8 @@
  *	This two functions create and destroy a SCTP-Core
  *	Compile: gcc -Wall -pedantic -c packets.c us_sctp_atomic.c sctp_fifo.c sctp_window.c us_sctp_core.c
  *	For implementation of RTT estimate use -DWITH_RTTADJ
- *	For implementation of congestion avoidance use -DWITH_CONGAV
+ *	For implementation of congestion avoidance use -DWITH_CONGAV (controller selected by SCTRLTP_CC, see sctp_cc.h)
+ *	For a token bucket pacing all frames sent use -DWITH_PACING (rate and burst from Parameters or PACE_*_ENV)
  */
 
 #include <pthread.h>
@@ -16,9 +17,11 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <string.h>
-#include "us_sctp_timer.h"
 #include "us_sctp_defs.h"
 #include "packets.h"
 #include "sctp_atomic.h"
@@ -28,6 +31,12 @@
 
 namespace sctrltp {
 
+/* environment variables overriding Parameters::PACE_RATE (bytes per us) and PACE_BURST (bytes) (WITH_PACING) */
+#define PACE_RATE_ENV       "SCTRLTP_PACE_RATE"
+#define PACE_BURST_ENV      "SCTRLTP_PACE_BURST"
+#define PACE_RATE_MAX       100000ULL           /* bytes per us (100 GB/s), keeps the token arithmetic of TX within 64 bit */
+#define PACE_BURST_MAX      (1ULL << 30)        /* bytes */
+
 template <typename P>
 struct sctp_core {
 	char const* NAME;                       /* name of core */
@@ -35,16 +44,37 @@ struct sctp_core {
 	struct      empty_cl STATUS;            /*Is read by all threads and modifies their behaviour*/
 	__u32       ACK;                        /*Is updated by RX and equals to the last valid sequencenr received*/
 	__s32       REQ;                        /*Request bit: 1 ack transmission requested 0 no pending request*/
-	__u32       pad1[L1D_CLS/4-2];
+	__s32       SACK;                       /*Is set by RX if the remote announced SACK support at reset (WITH_SACK)*/
+	__u32       ACK_SENT;                   /*ACK last put on the wire by TX/RESEND, frames beyond it wait for an ACK*/
+	__u64       ACK_TIME;                   /*Is set by RX to the time (sctp_clock) the oldest frame waiting for an ACK arrived*/
+	__u32       pad1[L1D_CLS/4-6];
 	__u32       rACK;                       /*Is updated by RX and equals the last new ACK received*/
 	__s32       NEW;                        /*New bit: 1 new remote ACK recvd 0 opposite*/
-	__u32       pad2[L1D_CLS/4-2];
-	__u64       currtime;                   /*current time (CURRENTLY UPDATED BY RESEND THREAD)*/
+	__u64       rACK_tstamp;                /*Kernel RX timestamp of the frame carrying rACK (WITH_TIMESTAMPING)*/
+	__s32       RETX;                       /*Is set by RX to a frame remote misses (duplicate ACKs), TX resends it at once (-1: none)*/
+	volatile __u32 rACK_gen;                /*Odd while RX changes rACK and rACK_tstamp, TX reads the pair when it is even and unchanged (WITH_TIMESTAMPING)*/
+	__u32       pad2[L1D_CLS/4-6];
+	__u64       currtime;                   /*sctp_clock at the last tick of RESEND (for statistics, threads read the clock themselves)*/
+	__s64       pace_tokens;                /*Token bucket of TX and RESEND in 1/1000 bytes, guarded by txwin.lock; resends may overdraw it (WITH_PACING)*/
+	__u64       pace_time;                  /*Time (spin_clock) the bucket was last filled up to*/
+	__u64       pace_rate;                  /*Bucket fills with pace_rate bytes per us (0: no pacing)*/
+	__u64       pace_burst;                 /*and holds pace_burst bytes at most*/
 
 	sctp_window<P> txwin;		        /*sliding window of TX/RX*/
 	sctp_window<P> rxwin;               /*sliding window of RX*/
 	sctp_sock sock;		            /*packet socket structure*/
-	sctp_timer txtimer;              /*RTC/HPET timer for TX*/
+	pthread_mutex_t slock;          /*serialises writes of TX and RESEND to sock and reads of its error queue; held across syscalls, so it sleeps (never taken under txwin.lock)*/
+	__vs32 rs_busy;                 /*RESEND writes copies of frames in txwin, TX takes no ACK meanwhile (guarded by txwin.lock)*/
+	__vs32 tx_busy;                 /*TX writes frames it just registered, RESEND resends none meanwhile (guarded by txwin.lock)*/
+	__s32 rs_timer;                 /*timerfd RESEND sleeps on*/
+	__s32 rs_event;                 /*eventfd TX and RX wake RESEND by (see resend_wake)*/
+	__u64 rs_wake;                  /*deadline (sctp_clock) RESEND sleeps until, TIME_NONE if none*/
+	__u64 rs_next;                  /*earliest time RESEND resends further frames of the current retransmit burst (guarded by txwin.lock)*/
+	__u64 rs_start;                 /*time the current retransmit burst started*/
+	__u32 rs_sent;                  /*frames resent since then, 0 if TX saw progress since the last burst*/
+	__u32 rs_burst;                 /*retransmit burst in progress: expired frames wait for their slot*/
+	__u32 rs_low;                   /*low_seq of txwin when the burst started*/
+	__u32 rs_high;                  /*farthest frame from rs_low the burst resent*/
 
 	sctp_interface<P> *inter;           /*Includes tx_queue, rx_queue, alloc queue and buffer pool (SHARED)*/
 	pthread_t	txthr;			            /*The thread ids*/
@@ -62,6 +92,7 @@ struct sctp_core {
 /*Main interface functions to SCTP Core*/
 
 /*This function prepares and start SCTP algorithm
+ *rip "shm:<name>" connects the core to a memory link instead of the FPGA (see us_sctp_shm.h)
  *returning 1 on success otherwise a negative value*/
 
 template <typename P>
@@ -67,6 +67,9 @@ enum class ExitCode {
 	MAX_RESENDS = 12
 };
 
+/* buckets of the histogram of lock hold times: below 256 ns, below 512 ns, ..., 64 us and more (WITH_LOCKSTATS) */
+#define LOCK_HIST           10
+
 struct sctp_stats {
 	__u64	nr_received;    /*Number of packets received (total)*/
 	__u64	nr_received_payload;    /*Number of packets with payload received*/
@@ -79,18 +82,60 @@ struct sctp_stats {
 	__u64	bytes_sent;	    /*Total Number of bytes sent*/
 	__u64	bytes_recv_payload;	/*Total Number of bytes received (without dropped packets)*/
 	__u64	bytes_recv_oow;	/*Total Number of bytes received out of window (without dropped packets)*/
-	__u64	RTT;		    /*Current estimated round trip time in milliseconds*/
+	__u64	RTT;		    /*Current retransmission timeout in microseconds (estimated from the round trip time with WITH_RTTADJ)*/
+	__u64	nr_rx_batches;	/*Number of socket reads returning data (nr_received/nr_rx_batches = avg. batch size)*/
+	__u64	nr_sent;	    /*Number of frames sent (including resends and ACK frames)*/
+	__u64	nr_tx_syscalls;	/*Number of send syscalls (nr_tx_syscalls/nr_sent = syscalls per frame)*/
+	__u64	nr_ringdrop;	/*Number of packets dropped by the kernel because the RX ring was full (WITH_PACKET_MMAP)*/
+	__u64	ns_spin_rx;	    /*Time RX spun on the socket before blocking (WITH_BUSY_POLL)*/
+	__u64	ns_spin_tx;	    /*Time TX spun on tx_queue/rACK before sleeping (WITH_BUSY_POLL)*/
+	__u64	ns_spin_user;	/*Time users spun in recv_buf before sleeping, summed over all clients (WITH_BUSY_POLL)*/
+	__u64	bytes_zc_saved;	/*Bytes the kernel sent without copying them (WITH_ZEROCOPY)*/
+	__u64	nr_zc_completions; /*Number of zerocopy sends completed by the kernel (WITH_ZEROCOPY)*/
+	__u64	nr_zc_copied;	/*Number of zerocopy sends the kernel had to copy anyway (WITH_ZEROCOPY)*/
+	__u64	ns_zc_latency;	/*Summed time from zerocopy send to its completion (WITH_ZEROCOPY)*/
+	__u64	nr_fltdrop_short; /*Number of datagrams dropped by the socket filter, too short for an ARQ frame (WITH_BPF)*/
+	__u64	nr_fltdrop_len;	/*Number of datagrams dropped by the socket filter, LEN does not match size (WITH_BPF)*/
+	__u64	nr_sockdrop;	/*Number of datagrams the kernel dropped on the UDP socket: receive queue full or socket filter (SO_RXQ_OVFL)*/
+	__u64	nr_tx_blocked;	/*Number of sends that found the socket buffer full and waited for it*/
+	__u64	ns_tx_blocked;	/*Time sends waited for the socket buffer*/
+	__u64	nr_sack_sent;	/*Number of SACK frames sent instead of plain ACK frames (WITH_SACK)*/
+	__u64	nr_sacked;	    /*Number of frames the remote acknowledged selectively, they are not resent (WITH_SACK)*/
+	__u64	nr_resent_fast;	/*Number of frames resent after duplicate ACKs (fast retransmit)*/
+	__u64	nr_resent_timeout; /*Number of frames resent after their timeout*/
+	__u64	srtt;	        /*Smoothed round trip time in microseconds, 0 before the first sample (WITH_RTTADJ)*/
+	__u64	rttvar;	        /*Round trip time variation in microseconds (WITH_RTTADJ)*/
+	__u64	nr_rto_backoff;	/*Number of times the retransmission timeout was doubled after timeouts (WITH_RTTADJ)*/
+	__u64	nr_paced;	    /*Number of times TX waited for the token bucket before sending new frames (WITH_PACING)*/
+	__u64	ns_paced;	    /*Time TX waited for the token bucket (WITH_PACING)*/
+	__u64	nr_ack_sent;	/*Number of ACK (or SACK) frames sent without data*/
+	__u64	nr_ack_piggybacked; /*Number of requested ACKs which were carried by data frames instead*/
+	__u64	nr_ack_ooo;	    /*Number of ACKs requested at once since frames arrived out of sequence*/
+	__u64	nr_ack_delayed;	/*Number of ACKs requested after DELAY_ACK (frames arriving in a trickle)*/
+	__u64	nr_resend_wakeups; /*Number of times RESEND woke up for a deadline (it sleeps while nothing is in flight)*/
+	__u64	nr_resend_stale; /*Number of times RESEND left frames alone, because TX did not take the remote ACK yet*/
+	__u64	nr_resend_bursts; /*Number of retransmit bursts RESEND started after a timeout*/
+	__u64	nr_resend_stopped; /*Number of frames of retransmit bursts not resent, since the remote got frames beyond the burst first*/
+	__u64	nr_resent_spurious; /*Number of frames resent after their timeout whose ACK came too soon to answer the resent copy (WITH_RTTADJ)*/
+	__u64	nr_wlock_held[LOCK_HIST]; /*Number of times the TX window lock was held for a time of the bucket (WITH_LOCKSTATS)*/
+	__u64	ns_wlock_held;	/*Time the TX window lock was held in total (WITH_LOCKSTATS)*/
+	__u64	ns_wlock_max;	/*Longest time the TX window lock was held at once (WITH_LOCKSTATS)*/
 };
-static_assert(sizeof(struct sctp_stats) == (sizeof(__u64)*12), "");
+static_assert(sizeof(struct sctp_stats) == (sizeof(__u64)*(48+LOCK_HIST)), "");
 
 template<typename P>
 struct sctp_internal {
 	struct arq_frame<P> *req;   /*pointer to packet to transmit or to packet was transmitted*/
 	struct arq_frame<P> *resp;  /*pointer to packet was received (in rx_queue there is always a response and a corr. request)*/
 	__u64	time;		        /*Timestamp of initial transmission*/
+	__u64   tstamp;             /*Kernel TX timestamp of the last transmission, 0 if unknown (WITH_TIMESTAMPING)*/
+	__u64   rtime;              /*Timestamp of the last transmission, the resend timeout runs from here*/
 	__u32	ntrans;			    /*Number of transmissions (send/resend(s))*/
-	__u8    acked;              /*0 = not acknowledged 1 = otherwise*/
-	__u8    pad[L1D_CLS-2*PTR_SIZE-13];
+	__u32   zc_id;              /*Id of the last zerocopy send of req (valid if zc is set)*/
+	__u32   rs_prev;            /*Neighbours in the resend list of the window (SEQ_NONE at its ends)*/
+	__u32   rs_next;
+	__u8    zc;                 /*req was sent zerocopy, kernel may still reference it (WITH_ZEROCOPY)*/
+	__u8    pad[L1D_CLS-2*PTR_SIZE-41];
 };
 
 #define PARAMETERISATION(Name, name) static_assert(sizeof(sctp_internal<Name>) == L1D_CLS, "");
@@ -144,6 +189,9 @@ struct sctp_interface {                 /*Bidirectional interface between layers
 
 	struct sctp_stats       stats;
 	struct arq_frame<P>     pool[P::ALLOCTX_BUFSIZE + P::ALLOCRX_BUFSIZE];
+#ifdef WITH_TIMESTAMPING
+	__u64                   tstamp[P::ALLOCTX_BUFSIZE + P::ALLOCRX_BUFSIZE]; /*Kernel RX timestamp of pool[i]*/
+#endif
 
 };
 // TODO: check for more?
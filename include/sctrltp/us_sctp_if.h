@@ -70,6 +70,9 @@ struct buf_desc {
 	/* TODO: do we need raw UDP frame? */
 	arq_frame<P> *arq_sctrl;
 	__u64 *payload;
+	/* received frames: kernel RX timestamp in ns, SOCK_TS_HW set if taken by the NIC's clock
+	 * (0 if unknown or not built WITH_TIMESTAMPING) */
+	__u64 tstamp;
 };
 
 /*abstract functions to use framework more efficiently*/
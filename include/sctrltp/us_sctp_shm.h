@@ -0,0 +1,78 @@
+#pragma once
+/* Memory transport for the socket layer
+ * Two endpoints exchange frames through a pair of lock-free single producer/single consumer rings
+ * in POSIX shared memory instead of UDP datagrams: a core (started with "shm:<name>" as remote
+ * address) and its peer, e.g. an FPGA model in a unit test or benchmark. The peer has to behave like
+ * the FPGA: reset frames arrive in-band (starting with HW_HOSTARQ_MAGICWORD where other frames
+ * carry an ACK < MAX_NRFRAMES) and have to be answered with the CFG frame.
+ * The rings do not drop frames: a sender waits while the ring to the other endpoint is full.
+ * Endpoints block on an empty (or full) ring with a futex, so this also works across processes.
+ * Whoever attaches first creates the link, the second endpoint removes its name again (a stale
+ * link of a crashed run has to be removed from /dev/shm by hand).*/
+
+#include "sctrltp/build-config.h"
+#include <linux/types.h>
+#include <stddef.h>
+
+#include "sctrltp/sctp_atomic.h"
+
+namespace sctrltp {
+
+struct sctp_sock;
+struct sock_transport;
+
+/* remote address of SCTP_CoreUp selecting the memory transport */
+#define SHM_ADDR_PREFIX      "shm:"
+/* slots per direction (power of 2) */
+#define SHM_NR_SLOTS         4096
+/* readers and writers spin this often on an empty/full ring before they sleep */
+#define SHM_SPIN             1000
+/* the second endpoint waits this long for the first one to set up the link */
+#define SHM_ATTACH_TIMEOUT   1000000 /* us */
+
+/* one direction of the link: the producer owns head, the consumer owns tail
+ * (both count slots and wrap; page aligned, they are futexes) */
+struct shm_ring {
+	__vs32 head;                /* slots filled                              */
+	__vs32 rx_wait;             /* consumer sleeps on head                   */
+	__u32 pad0[1024 - 2];
+	__vs32 tail;                /* slots consumed                            */
+	__vs32 tx_wait;             /* producer sleeps on tail                   */
+	__u32 pad1[1024 - 2];
+};
+static_assert(sizeof(struct shm_ring) == 2 * 4096, "");
+
+/* the shared memory object: this header followed by the slots of ring[0] and of ring[1] */
+struct shm_link {
+	__vs32 ready;               /* set by the creator once the link is set up */
+	__u32 slot_size;            /* bytes per slot (shm_slot + largest frame)  */
+	__u32 nr_slots;
+	__u32 pad[1024 - 3];
+	struct shm_ring ring[2];    /* [0]: creator to second endpoint, [1]: back */
+};
+static_assert((sizeof(struct shm_link) % 4096) == 0, "");
+
+/* header of a slot, the frame follows */
+struct shm_slot {
+	__u32 len;
+	__u32 pad;
+};
+
+/* one endpoint of a link */
+struct sctp_shm {
+	struct shm_link *link;
+	size_t map_len;
+	struct shm_ring *tx;
+	struct shm_ring *rx;
+	__u8 *tx_slots;
+	__u8 *rx_slots;
+};
+
+/* attaches ssock to the link name (ssock is initialized, its transport is set to shm_transport);
+ * frame_size is the size of the largest frame, both endpoints have to agree on it
+ * returns 0 on success, SC_ABORT otherwise*/
+__s8 shm_init (struct sctp_sock *ssock, char const *name, __u32 frame_size);
+
+extern struct sock_transport const shm_transport;
+
+} // namespace sctrltp
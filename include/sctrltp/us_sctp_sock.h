@@ -14,56 +14,191 @@
 #include <net/ethernet.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/uio.h>
 #include "us_sctp_defs.h"
 
 #include "packets.h"
+#include "us_sctp_uring.h"
+#include "us_sctp_xdp.h"
+#include "us_sctp_shm.h"
 
-/* Berkeley Packet Filter */
+/* Socket filter: malformed datagrams (shorter than the ARQ header, LEN not matching the datagram
+ * size) are dropped in the kernel; an eBPF filter counts the drops in a map (SOCK_FLT_*), without
+ * the privileges for it a classic BPF filter with the same checks is attached (drops not counted) */
 #ifdef WITH_BPF
-#include "bpf.h"
+#include <linux/filter.h>
+#define SOCK_FLT_SHORT  0           /* datagram shorter than the ARQ header (and no ACK frame) */
+#define SOCK_FLT_LEN    1           /* LEN field does not match the datagram size */
+#define SOCK_FLT_NR     2
 #endif
 
 /* PACKET_RX_RING stuff */
 #ifdef WITH_PACKET_MMAP
-#include "packets.h"
 #include <linux/if_packet.h>
-#include <poll.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <ifaddrs.h>
 #include <sys/mman.h>
-#include <sys/user.h>
-/* should be true on 2.6/i386 kernel */
-#define MAX_ORDER 11
 #else
 #include <netpacket/packet.h>
 #endif
 
-namespace sctrltp {
+/* maximum number of datagrams handled by one batched socket call */
+#define SOCK_MAX_BATCH 64
 
-#ifdef WITH_PACKET_MMAP
-static struct sctp_sock *debug;
+/* sends do not block in the kernel: with a full socket buffer they poll for POLLOUT, at most this
+ * long at a time (a warning is logged every time the wait runs out, then the send is retried) */
+#define SOCK_TX_WAIT_MS 100
+
+/* every read reports the number of datagrams the kernel dropped on the socket so far */
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+
+/* UDP generic segmentation offload: one send hands a run of equally sized frames to the kernel */
+#ifdef WITH_UDP_GSO
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+/* limits of the kernel: segments per send and UDP payload of the unsegmented datagram */
+#define SOCK_GSO_MAX_SEGS  64
+#define SOCK_GSO_MAX_BYTES (65535 - 20 - 8)
 #endif
 
+/* UDP generic receive offload: the kernel hands us coalesced datagrams, which are split into frames */
+#ifdef WITH_UDP_GRO
+#include <netinet/udp.h>
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+/* staging area for one coalesced datagram (maximum UDP payload) */
+#define SOCK_GRO_BUFSIZE 65536
+#endif
+
+/* MSG_ZEROCOPY: large frames are sent from the pool without copying, the kernel reports completions
+ * on the error queue; frames must not be reused before their send completed */
+#if defined(WITH_ZEROCOPY) || defined(WITH_TIMESTAMPING)
+#include <linux/errqueue.h>
+#endif
+#ifdef WITH_ZEROCOPY
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+/* messages smaller than this are copied (pinning pages costs more than copying) */
+#define SOCK_ZC_MIN_BYTES 1024
+/* sends tracked for statistics (power of 2) and completions arriving out of order */
+#define SOCK_ZC_TRACK     4096
+#define SOCK_ZC_RANGES    32
+#endif
+
+/* SO_TIMESTAMPING: the kernel stamps every datagram when it arrives and when it leaves (software,
+ * or by the NIC if its hardware timestamping is switched on, e.g. by ptp4l/hwstamp_ctl); TX
+ * timestamps come back on the error queue keyed by the number of the send (OPT_ID).
+ * Timestamps are ns since the epoch (CLOCK_REALTIME) or of the NIC's clock if SOCK_TS_HW is set,
+ * 0 if unknown */
+#ifdef WITH_TIMESTAMPING
+#include <linux/net_tstamp.h>
+#define SOCK_TS_HW     (1ULL << 63)
+/* sends (and frames sent) tracked until their timestamp arrives (power of 2) */
+#define SOCK_TS_TRACK  4096
+#endif
+
+namespace sctrltp {
+
+/* a transport replacing the UDP socket (chosen when the socket is set up, see sctp_sock::tp);
+ * the functions have the contracts of sock_read_batch, sock_write_batch and sock_write_reset,
+ * frames are passed untyped (buflen: size of the receive buffers)*/
+struct sock_transport {
+	char const *name;
+	__s32 (*read_batch) (struct sctp_sock *ssock, void **bufs, __s32 *nread, __u32 num, __u32 buflen);
+	__s32 (*write_batch) (struct sctp_sock *ssock, void *const *bufs, __u32 const *len, __u32 num);
+	__s32 (*write_reset) (struct sctp_sock *ssock, void const *buf, __u32 len);
+};
+
 struct sctp_sock {
+	struct sock_transport const *tp; /* NULL: UDP socket (with the backends compiled in) */
 	__s32 sd;
+#ifdef WITH_BPF
+	__s32 filter_map;           /* drop counters of the eBPF filter (-1: classic filter) */
+#endif
 #ifdef DEBUG
 	__s32 debug_fd;
 #endif
 #ifdef WITH_PACKET_MMAP
-	#define KILOBYTE         1024
-	#define MEGABYTE        (1024 * KILOBYTE)
-
-	#define	TP_BLOCK_SIZE   (  16 * KILOBYTE)
-	#define	TP_FRAME_SIZE   (  16 * KILOBYTE)
-	/* size has to be 2<<X */
-	#define	TP_BLOCK_NR     (   8 * MEGABYTE / TP_BLOCK_SIZE)
-	#define	TP_FRAME_NR     (TP_BLOCK_SIZE / TP_FRAME_SIZE * TP_BLOCK_NR)
-	void *ring_ptr;         /* pointer to rx ring                       */
-	void **ring;            /* pointer to frame pointers                */
-	int ring_cnt;
-	int ring_idx;
-	int drops;
-	struct pollfd pfd;      /* poll structure for poll()-for-new-packet */
-	struct tpacket_req req; /* rx ring request structure                */
+	/* TPACKET_V3 rx ring on a packet socket, filtered to the FPGA's UDP flow:
+	 * the kernel packs frames into blocks and hands out a block when it is full or after
+	 * TP_RETIRE_TOV ms (which bounds the added latency at low rates) */
+	#define KILOBYTE        1024
+
+	#define TP_BLOCK_SIZE   ( 128 * KILOBYTE)
+	#define TP_BLOCK_NR     64
+	#define TP_FRAME_SIZE   2048    /* hint only, frames are packed */
+	#define TP_RETIRE_TOV   1
+	__s32 ring_sd;              /* packet socket owning the ring            */
+	__u8 *ring_ptr;             /* mapped rx ring                           */
+	__u32 ring_idx;             /* block currently read                     */
+	__u32 ring_left;            /* frames not yet read in that block        */
+	__u8 *ring_pkt;             /* next frame in that block                 */
+	struct pollfd pfd;          /* poll structure for poll()-for-new-block  */
+	struct tpacket_req3 req;    /* rx ring request structure                */
+#endif
+#ifdef WITH_IO_URING
+	struct sctp_uring uring;    /* io_uring transport backend                */
+#endif
+#ifdef WITH_AF_XDP
+	struct sctp_xdp xdp;        /* AF_XDP transport backend                  */
+#endif
+	struct sctp_shm shm;        /* memory transport (tp == &shm_transport)   */
+#ifdef WITH_UDP_GSO
+	__u8 gso;                   /* segmentation offload usable (cleared if the kernel refuses it) */
+#endif
+#ifdef WITH_ZEROCOPY
+	__u8 zc;                    /* SO_ZEROCOPY enabled                       */
+	__u32 zc_next;              /* id of the next zerocopy send              */
+	__u32 zc_done;              /* all sends before this id completed        */
+	__u32 zc_nranges;           /* completed ranges beyond zc_done           */
+	__u32 zc_ranges[SOCK_ZC_RANGES][2];
+	__u32 zc_len[SOCK_ZC_TRACK];   /* bytes of send id (% SOCK_ZC_TRACK)     */
+	__u64 zc_time[SOCK_ZC_TRACK];  /* send time (spin_clock) of id           */
+#endif
+#ifdef WITH_TIMESTAMPING
+	__u8 ts;                    /* SO_TIMESTAMPING enabled                   */
+	__u32 ts_next;              /* key of the next send                      */
+	__u32 ts_first[SOCK_TS_TRACK]; /* first frame (in ts_frame) of send key  */
+	__u16 ts_nframes[SOCK_TS_TRACK]; /* number of frames of send key         */
+	void *ts_frame[SOCK_TS_TRACK]; /* frames of the recent sends             */
+	__u32 ts_fpos;              /* next entry in ts_frame                    */
+	void *ts_done_frame[SOCK_TS_TRACK]; /* stamped frames not yet handed out */
+	__u64 ts_done[SOCK_TS_TRACK];
+	__u32 ts_done_head;
+	__u32 ts_done_num;
+	__u64 rx_tstamp[SOCK_MAX_BATCH]; /* RX timestamps of the last sock_read_batch */
+#endif
+#ifdef WITH_UDP_GRO
+	__u8 gro;                   /* receive offload enabled                   */
+	__u16 gro_segsize;          /* segment size of the staged datagram       */
+	__u32 gro_len;              /* bytes of the staged datagram              */
+	__u32 gro_off;              /* offset of first segment not handed out    */
+	__u8 *gro_buf;              /* staging area (SOCK_GRO_BUFSIZE)           */
+#ifdef WITH_TIMESTAMPING
+	__u64 gro_tstamp;           /* arrival of the staged datagram            */
+#endif
+#endif
+	struct sctp_stats *stats;   /* socket level statistics (shared mem, set after sock_init) */
+	__u32 rx_drops;             /* kernel drop counter (SO_RXQ_OVFL) seen by the last read */
+#ifdef WITH_BUSY_POLL
+	__u32 busy_poll_us;         /* reads spin this long before they block (0 = off) */
 #endif
 	__u32 local_ip;
 	__u32 remote_ip;
@@ -84,15 +219,78 @@ __s8 sock_init(
     const __u16 reset_port,
     const __u16 data_local_port);
 
+/* tells the socket about the frame pool (base, len) after sock_init
+ * (io_uring: the pool gets registered as fixed buffer for sending)*/
+void sock_register_pool (sctp_sock *ssock, void *base, size_t len);
+
+/* lets reads spin for up to us microseconds before blocking (WITH_BUSY_POLL, no-op otherwise);
+ * the kernel polls the device for the socket during that time as well (SO_BUSY_POLL)*/
+void sock_busy_poll (sctp_sock *ssock, __u32 us);
+
+/* some backends receive into frames they own, they take these once from the given empty pool frames
+ * (from the end of bufs); returns number of frames taken (0 if backend has enough or does not need any)*/
+template<typename arq_frame>
+__u32 sock_provide_rx (sctp_sock *ssock, arq_frame **bufs, __u32 num);
+
 /* returns number of bytes stored into buf (should be HEADER+NB*SCTRLCMD bytes)
  * filter = 1: filter enabled, will return -1 if frame has not passed filter checks*/
 template<typename arq_frame>
 __s32 sock_read (sctp_sock *ssock, arq_frame *buf, __u8 filter);
 
+/* blocks until at least one datagram arrived and reads up to num (<= SOCK_MAX_BATCH) datagrams
+ * into bufs without further blocking; returns number of datagrams read (SC_ABORT on error)
+ * nread[i] holds the number of bytes stored into bufs[i] (SC_INVAL for empty datagrams)
+ * (WITH_BUSY_POLL: spins for data up to busy_poll_us before blocking)
+ * (WITH_TIMESTAMPING: ssock->rx_tstamp[i] holds the arrival time of bufs[i])
+ * datagrams dropped by the kernel since the last read are added to ssock->stats->nr_sockdrop
+ * (UDP socket only, the other backends report no drops or have their own counter)
+ * NOTE: backends receiving into their own frames exchange pool frames in bufs[0..ret-1]
+ * (WITH_UDP_GRO: coalesced datagrams are split, each segment is copied into its own frame)*/
+template<typename arq_frame>
+__s32 sock_read_batch (sctp_sock *ssock, arq_frame **bufs, __s32 *nread, __u32 num);
+
 /*returns number of bytes actually written (should be equal to len, if its not -4 is returned)*/
 template<typename arq_frame>
 __s32 sock_write (sctp_sock *ssock, arq_frame *buf, __u32 len);
 
+/* sends the reset frame buf to the remote reset port; returns number of bytes written, SC_ABORT on
+ * error (errno is preserved)*/
+__s32 sock_write_reset (sctp_sock *ssock, void const *buf, __u32 len);
+
+/* sends num (<= SOCK_MAX_BATCH) frames of the given lengths with as few syscalls as possible
+ * (WITH_UDP_GSO: runs of equally sized frames are sent as one segmented datagram each)
+ * (WITH_ZEROCOPY: messages of at least SOCK_ZC_MIN_BYTES are sent zerocopy, ssock->zc_next - 1 is
+ *  the id of the last one; the frames have to stay untouched until sock_zc_done)
+ * a full socket buffer is waited for (see SOCK_TX_WAIT_MS), counted in ssock->stats->nr_tx_blocked
+ * returns number of frames written (SC_ABORT if a frame could not be written completely)*/
+template<typename arq_frame>
+__s32 sock_write_batch (sctp_sock *ssock, arq_frame **bufs, __u32 const *len, __u32 num);
+
+#ifdef WITH_BPF
+/* copies the drop counters of the socket filter into ssock->stats */
+void sock_filter_stats (sctp_sock *ssock);
+#endif
+
+#ifdef WITH_TIMESTAMPING
+/* collects the TX timestamps the kernel reported so far (non-blocking; writes change the same state,
+ * so call with the lock serialising writes to ssock held)
+ * frames[i] was sent at ts[i] (its last send, if it was sent more than once); returns number of frames*/
+__u32 sock_tx_tstamps (sctp_sock *ssock, void **frames, __u64 *ts, __u32 num);
+#endif
+
+#ifdef WITH_ZEROCOPY
+/* collects zerocopy completions from the error queue (non-blocking; writes reap it too, so call with
+ * the lock serialising writes to ssock held)
+ * returns number of sends completed*/
+__s32 sock_zc_reap (sctp_sock *ssock);
+
+/* true if the zerocopy send id (and all before) completed, i.e. its frames may be reused */
+static inline bool sock_zc_done (sctp_sock const *ssock, __u32 id)
+{
+	return ((__s32)(id - ssock->zc_done) < 0);
+}
+#endif
+
 /*returns number of bytes actually written (should be equal to len, if its not -4 is returned)*/
 __s32 sock_writev (sctp_sock *ssock, iovec const *iov, int iovcnt);
 
@@ -0,0 +1,103 @@
+#pragma once
+/* io_uring transport backend for the socket layer (WITH_IO_URING)
+ * The rings are driven by raw syscalls, so there is no dependency on liburing.
+ * - RX: one multishot receive stays posted on the socket, datagrams land in pool frames which
+ *       are handed to the kernel through a provided buffer ring
+ * - TX: a burst of frames is queued as one batch of SQEs, frames inside the (registered)
+ *       pool are sent as fixed buffers; with WITH_IO_URING_SQPOLL no syscall is needed at all
+ *       as long as the kernel side poll thread is awake*/
+
+#include "sctrltp/build-config.h"
+#include <linux/types.h>
+#include <stddef.h>
+
+#ifdef WITH_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+namespace sctrltp {
+
+struct sctp_stats;
+
+/* number of receive buffers (pool frames) owned by the multishot receive (power of 2) */
+#define URING_RX_BUFS 64
+/* number of SQEs of the transmit ring (at least SOCK_MAX_BATCH) */
+#define URING_TX_ENTRIES 64
+
+#ifdef WITH_IO_URING
+
+/* one io_uring instance and its mapped submission/completion rings */
+struct uring_queue {
+	__s32 fd;
+	__u32 features;
+	__u32 setup_flags;
+	/* submission queue */
+	__u32 *sq_head;
+	__u32 *sq_tail;
+	__u32 *sq_mask;
+	__u32 *sq_flags;
+	__u32 *sq_array;
+	struct io_uring_sqe *sqes;
+	__u32 sq_local_tail;        /* SQEs prepared by us (not yet published if != *sq_tail) */
+	__u32 sq_pending;           /* SQEs published but not yet submitted by io_uring_enter */
+	/* completion queue */
+	__u32 *cq_head;
+	__u32 *cq_tail;
+	__u32 *cq_mask;
+	struct io_uring_cqe *cqes;
+	/* mappings */
+	void *sq_ring_ptr;
+	size_t sq_ring_sz;
+	void *cq_ring_ptr;
+	size_t cq_ring_sz;
+	size_t sqes_sz;
+};
+
+struct sctp_uring {
+	struct uring_queue rx;
+	struct uring_queue tx;
+	volatile __s32 txlock;      /* TX and RESEND thread share the transmit ring */
+
+	/* provided buffer ring for the multishot receive */
+	struct io_uring_buf_ring *bufring;
+	__u16 bufring_tail;
+	__u16 rx_provided;          /* number of buffer ids in use */
+	__u32 rx_buflen;
+	void *rx_bufs[URING_RX_BUFS]; /* frame currently owned by buffer id */
+	__u8 rx_armed;              /* multishot receive is posted */
+
+	/* pool region (registered as fixed buffer on the transmit ring if fixed_reg is set) */
+	__u8 *pool_base;
+	size_t pool_len;
+	__u8 fixed_reg;
+};
+
+/* sets up both rings for the connected socket sd and registers the provided buffer ring
+ * returns 0 on success, SC_ABORT otherwise*/
+__s8 uring_init (struct sctp_uring *ur, __s32 sd);
+
+/* registers the frame pool (base, len) as fixed buffer for sending
+ * (failure is not fatal, frames are sent as normal buffers then)*/
+void uring_register_pool (struct sctp_uring *ur, void *base, size_t len);
+
+/* hands empty pool frames (of buflen bytes) to the multishot receive until it owns URING_RX_BUFS
+ * frames; the frames are taken from the end of bufs, returns number of frames taken*/
+__u32 uring_provide_rx (struct sctp_uring *ur, void **bufs, __u32 num, __u32 buflen);
+
+/* blocks until at least one datagram arrived and returns up to num datagrams
+ * exchange = 1: pool frames in bufs are exchanged against the frames holding the data (the given
+ * frames replace them in the receive ring), other buffers (or exchange = 0) get the data copied into.
+ * nread[i] holds the number of bytes in bufs[i], returns number of datagrams (SC_ABORT on error)*/
+__s32 uring_recv (struct sctp_uring *ur, __s32 sd, void **bufs, __s32 *nread, __u32 num, __u8 exchange);
+
+/* returns 1 if completions of the receive are pending (uring_recv would not block) */
+__u8 uring_rx_ready (struct sctp_uring *ur);
+
+/* sends num (<= URING_TX_ENTRIES) datagrams and waits for their completion
+ * returns num (SC_ABORT if a datagram could not be sent completely)*/
+__s32 uring_send (struct sctp_uring *ur, __s32 sd, void *const *bufs, __u32 const *len, __u32 num,
+                  struct sctp_stats *stats);
+
+#endif // WITH_IO_URING
+
+} // namespace sctrltp
@@ -0,0 +1,96 @@
+#pragma once
+/* AF_XDP transport backend for the socket layer (WITH_AF_XDP)
+ * Frames of the FPGA's UDP flow are steered by a small XDP program into an XSK bound to one queue
+ * of the interface the data socket is routed over; everything else takes the normal network stack.
+ * The backend builds and strips Ethernet, IPv4 and UDP headers itself. The UDP socket stays open: it
+ * is used for the reset frame and as fallback for frames sent before the FPGA's MAC is known.
+ * Copy mode (XDP_COPY) is used, so it works on any interface (e.g. veth) without driver support;
+ * loopback and interfaces with more than one RX queue are not supported (the socket layer falls back
+ * to the UDP socket).*/
+
+#include "sctrltp/build-config.h"
+#include <linux/types.h>
+#include <net/if.h>
+
+#ifdef WITH_AF_XDP
+#include <linux/if_xdp.h>
+#endif
+
+namespace sctrltp {
+
+struct sctp_stats;
+
+/* UMEM chunk size and number of chunks (first half used for RX, second half for TX) */
+#define XDP_CHUNK_SIZE 2048
+#define XDP_NR_CHUNKS  4096
+/* ring sizes (power of 2) */
+#define XDP_RING_SIZE  2048
+/* XSK queue id the FPGA traffic is expected on */
+#define XDP_QUEUE_ID   0
+/* length of Ethernet + IPv4 (without options) + UDP header */
+#define XDP_HDR_LEN    (14 + 20 + 8)
+
+#ifdef WITH_AF_XDP
+
+/* producer/consumer ring shared with the kernel */
+struct xdp_ring {
+	__u32 *producer;
+	__u32 *consumer;
+	__u32 *flags;
+	void *descs;
+	__u32 mask;
+	__u32 cached_prod;
+	__u32 cached_cons;
+	void *map;
+	size_t map_len;
+};
+
+struct sctp_xdp {
+	__s32 fd;                   /* XSK (-1: backend not in use) */
+	__s32 prog_fd;
+	__s32 map_fd;
+	__s32 link_fd;
+	__u32 ifindex;
+	char ifname[IF_NAMESIZE];
+
+	__u8 *umem;
+	struct xdp_ring fill;
+	struct xdp_ring comp;
+	struct xdp_ring rx;
+	struct xdp_ring tx;
+
+	volatile __s32 txlock;      /* TX and RESEND thread share the TX ring */
+	__u64 tx_free[XDP_NR_CHUNKS / 2]; /* TX chunks not in flight */
+	__u32 nr_tx_free;
+	__u16 ip_id;
+
+	/* addressing (network byte order) */
+	__u8 local_mac[6];
+	__u8 remote_mac[6];
+	__u8 remote_mac_valid;
+	__u32 local_ip;
+	__u32 remote_ip;
+	__u16 local_port;
+	__u16 remote_port;
+};
+
+/* sets up UMEM, XSK and the steering XDP program for the connected UDP socket sd
+ * returns 0 on success, SC_ABORT otherwise (everything is torn down again and xdp->fd is -1)*/
+__s8 xdp_init (struct sctp_xdp *xdp, __s32 sd);
+
+/* blocks until at least one frame arrived and copies up to num frames (payload of the UDP
+ * datagrams, at most buflen bytes) into bufs; nread[i] holds the number of bytes in bufs[i]
+ * returns number of frames, SC_ABORT on error*/
+__s32 xdp_recv (struct sctp_xdp *xdp, void **bufs, __s32 *nread, __u32 num, __u32 buflen);
+
+/* returns 1 if frames are waiting in the RX ring (xdp_recv would not block) */
+__u8 xdp_rx_ready (struct sctp_xdp *xdp);
+
+/* sends num frames as UDP datagrams (sd is used as long as the FPGA's MAC is unknown)
+ * returns num, SC_ABORT on error*/
+__s32 xdp_send (struct sctp_xdp *xdp, __s32 sd, void *const *bufs, __u32 const *len, __u32 num,
+                struct sctp_stats *stats);
+
+#endif // WITH_AF_XDP
+
+} // namespace sctrltp
@@ -74,6 +74,7 @@ void add_parameterization(py::module& m)
 	pypacket.def(py::init<>())
 	    .def_readwrite("pid", &packet<P>::pid)
 	    .def_readwrite("len", &packet<P>::len)
+	    .def_readonly("tstamp", &packet<P>::tstamp)
 	    .def(
 	        "__getitem__",
 	        [](packet<P> const& p, size_t const idx) {
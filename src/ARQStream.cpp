@@ -178,6 +178,7 @@ struct ARQStreamImpl
 		packet.seq = sctpreq_get_seq(buffer.arq_sctrl);
 		packet.pid = sctpreq_get_typ(buffer.arq_sctrl);
 		packet.len = sctpreq_get_len(buffer.arq_sctrl);
+		packet.tstamp = buffer.tstamp;
 	}
 };
 
@@ -565,7 +566,8 @@ void ARQStream<P>::parse_response()
 	// bitfile info can stretch over multiple packets
 	// extract all info words from current packet then if still info remaining continue
 	// with next packet
-	size_t const info_length = my_packet.pdu[3];
+	// the high half holds the protocol extensions the FPGA accepted (CFG_FEATURES_SHIFT)
+	size_t const info_length = my_packet.pdu[CFG_INFO] & ((1ULL << CFG_FEATURES_SHIFT) - 1);
 	if (info_length == 0) {
 		response.bitfile_info = "";
 		return;
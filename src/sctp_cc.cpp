@@ -0,0 +1,177 @@
+/*Congestion controllers of the TX window (see sctp_cc.h)*/
+
+#include <string.h>
+#include <math.h>
+
+#include "sctrltp/sctp_cc.h"
+#include "sctrltp/us_sctp_defs.h"
+
+namespace sctrltp {
+
+/*aimd: the original WITH_CONGAV algorithm*/
+
+static void aimd_init (struct sctp_cc_state *cc)
+{
+	cc->cwnd = 1;
+	cc->ssthresh = cc->max_wsize / 2;
+	cc->cnt = 0;
+}
+
+static __u8 aimd_can_send (struct sctp_cc_state const *cc, __u32 inflight)
+{
+	return (inflight < cc->cwnd);
+}
+
+static void aimd_on_ack (struct sctp_cc_state *cc, __u32, __u64)
+{
+	/*Grows once per window slide, no matter how many frames it acknowledged*/
+	if (cc->cwnd < cc->ssthresh) {
+		/*slow start*/
+		cc->cwnd++;
+	} else {
+		/*congestion avoidance strategy*/
+		/* cwnd += (1-(cwnd/max_wsize)) frames */
+		cc->cnt += 100 - (cc->cwnd * 100) / cc->max_wsize;
+		cc->cwnd += cc->cnt / 100;
+		cc->cnt %= 100;
+	}
+	if (cc->cwnd > cc->max_wsize)
+		cc->cwnd = cc->max_wsize;
+}
+
+static void aimd_on_loss (struct sctp_cc_state *cc, __u64)
+{
+	/*One frame in flight only: nothing new goes out until the window is empty, then slow start*/
+	cc->ssthresh = (cc->cwnd > 1) ? cc->cwnd / 2 : 1;
+	cc->cwnd = 1;
+	cc->cnt = 0;
+}
+
+/*cubic: RFC 8312, time in us and windows in frames*/
+
+#define CUBIC_C             0.4         /* frames/s^3 */
+#define CUBIC_BETA_NUM      7           /* window after a loss: 7/10 */
+#define CUBIC_BETA_DEN      10
+
+static void cubic_init (struct sctp_cc_state *cc)
+{
+	cc->cwnd = 1;
+	/*slow start to half the window, the cubic function probes for the rest*/
+	cc->ssthresh = cc->max_wsize / 2;
+	cc->cnt = 0;
+	cc->w_max = 0;
+	cc->w_est = 0;
+	cc->growing = 0;
+	cc->epoch = 0;
+	cc->k = 0;
+}
+
+static void cubic_on_ack (struct sctp_cc_state *cc, __u32 nacked, __u64 currtime)
+{
+	__u64 cwnd_s;
+	__u32 per_frame, per_reno;
+	double t, target;
+
+	if (cc->cwnd < cc->ssthresh) {
+		cc->cwnd += nacked;
+		if (cc->cwnd > cc->max_wsize)
+			cc->cwnd = cc->max_wsize;
+		return;
+	}
+
+	cwnd_s = (__u64) cc->cwnd * CC_SCALE;
+	if (!cc->growing) {
+		/*First ACK after a loss, the cubic function starts here*/
+		cc->growing = 1;
+		cc->epoch = currtime;
+		if (cc->w_max > cwnd_s) {
+			cc->k = (__u64)(cbrt ((double)(cc->w_max - cwnd_s) / CC_SCALE / CUBIC_C) * 1e6);
+		} else {
+			cc->k = 0;
+			cc->w_max = cwnd_s;
+		}
+		cc->w_est = cwnd_s;
+		cc->cnt = 0;
+	}
+
+	/*W(t) = C*(t-K)^3 + W_max*/
+	t = ((double) currtime - (double) cc->epoch - (double) cc->k) / 1e6;
+	target = CUBIC_C * t * t * t + (double) cc->w_max / CC_SCALE;
+	/*Grow at most by half the window per round*/
+	if (target > 1.5 * cc->cwnd)
+		target = 1.5 * cc->cwnd;
+	/*ACKs needed for the next frame*/
+	if (target > cc->cwnd + 0.01)
+		per_frame = (__u32)(cc->cwnd / (target - cc->cwnd));
+	else
+		per_frame = 100 * cc->cwnd;
+
+	/*Never slower than Reno with the same decrease (alpha = 3*(1-beta)/(1+beta) = 9/17 frames per window)*/
+	cc->w_est += (__u32)(((__u64) nacked * CC_SCALE * 9) / (17 * (__u64) cc->cwnd));
+	if (cc->w_est > cwnd_s) {
+		per_reno = (__u32)(cwnd_s / (cc->w_est - cwnd_s));
+		if (per_reno < per_frame)
+			per_frame = per_reno;
+	}
+	if (per_frame < 1)
+		per_frame = 1;
+
+	cc->cnt += nacked;
+	if (cc->cnt >= per_frame) {
+		cc->cwnd += cc->cnt / per_frame;
+		cc->cnt %= per_frame;
+	}
+	if (cc->cwnd > cc->max_wsize)
+		cc->cwnd = cc->max_wsize;
+}
+
+static void cubic_on_loss (struct sctp_cc_state *cc, __u64)
+{
+	__u64 cwnd_s = (__u64) cc->cwnd * CC_SCALE;
+
+	/*Fast convergence: the window shrank since the loss before, leave room for other senders*/
+	if (cwnd_s < cc->w_max)
+		cc->w_max = (__u32)((cwnd_s * (CUBIC_BETA_DEN + CUBIC_BETA_NUM)) / (2 * CUBIC_BETA_DEN));
+	else
+		cc->w_max = (__u32) cwnd_s;
+	cc->ssthresh = (cc->cwnd * CUBIC_BETA_NUM) / CUBIC_BETA_DEN;
+	if (cc->ssthresh < 2)
+		cc->ssthresh = 2;
+	if (cc->ssthresh > cc->max_wsize)
+		cc->ssthresh = cc->max_wsize;
+	cc->cwnd = cc->ssthresh;
+	cc->cnt = 0;
+	cc->growing = 0;
+}
+
+static void cubic_on_timeout (struct sctp_cc_state *cc, __u64 currtime)
+{
+	/*The remote dropped everything after the lost frame: resend it alone, slow start up to 70% again*/
+	cubic_on_loss (cc, currtime);
+	cc->cwnd = 1;
+}
+
+struct sctp_cc const sctp_cc_algos[SCTP_CC_NUM] = {
+	{ "aimd", aimd_init, aimd_can_send, aimd_on_ack, aimd_on_loss, aimd_on_loss },
+	{ "cubic", cubic_init, aimd_can_send, cubic_on_ack, cubic_on_loss, cubic_on_timeout },
+};
+
+__s32 cc_find (char const *name)
+{
+	__s32 i;
+
+	for (i = 0; i < SCTP_CC_NUM; i++)
+		if (!strcmp (name, sctp_cc_algos[i].name))
+			return i;
+	return SC_INVAL;
+}
+
+void cc_init (struct sctp_cc_state *cc, __u32 algo, __u32 max_wsize)
+{
+	memset (cc, 0, sizeof(struct sctp_cc_state));
+	cc->algo = algo;
+	cc->max_wsize = max_wsize;
+	sctp_cc_algos[algo].init (cc);
+}
+
+} // namespace sctrltp
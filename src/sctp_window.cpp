@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <endian.h>
 #include "sctrltp/sctp_window.h"
 #include "sctrltp/us_sctp_sock.h" /* debug helper functions */
 
@@ -19,13 +20,77 @@ static inline sctp_internal<P> *get_frame (sctp_window<P> *win, __u32 seq)
 	return tmp;
 }
 
+/*Bitmaps hold one bit per SEQ (max_frames bits, words beyond are zero): bits_* work on runs of up to 64 SEQ
+ *at once, wrapping around at max_frames*/
+static inline __u64 low_bits (__u32 n)
+{
+	return (n >= 64) ? ~0ULL : ((1ULL << n) - 1);
+}
+
+static inline __u8 test_bit (__u64 const *map, __u32 seq)
+{
+	return (map[seq >> 6] >> (seq & 63)) & 1;
+}
+
+static inline void set_bit (__u64 *map, __u32 seq)
+{
+	map[seq >> 6] |= 1ULL << (seq & 63);
+}
+
+/*Returns the n (at most 64) bits from seq on, bit i for seq+i*/
 template <typename P>
-static inline __u8 is_marked_frame (sctp_window<P> *win, __u32 seq)
+static inline __u64 bits_get (sctp_window<P> const *win, __u64 const *map, __u32 seq, __u32 n)
 {
-	struct sctp_internal<P> *tmp;
-	tmp = get_frame<P> (win, seq);
-	if (tmp->acked) return 1;
-	return 0;
+	__u64 ret = 0;
+	__u32 got = 0, pos, span;
+
+	while (got < n) {
+		pos = (seq + got) & win->mask;
+		span = 64 - (pos & 63);
+		if (span > win->max_frames - pos)
+			span = win->max_frames - pos;
+		if (span > n - got)
+			span = n - got;
+		ret |= ((map[pos >> 6] >> (pos & 63)) & low_bits (span)) << got;
+		got += span;
+	}
+	return ret;
+}
+
+/*Clears the n bits from seq on*/
+template <typename P>
+static inline void bits_clear (sctp_window<P> const *win, __u64 *map, __u32 seq, __u32 n)
+{
+	__u32 done = 0, pos, span;
+
+	while (done < n) {
+		pos = (seq + done) & win->mask;
+		span = 64 - (pos & 63);
+		if (span > win->max_frames - pos)
+			span = win->max_frames - pos;
+		if (span > n - done)
+			span = n - done;
+		map[pos >> 6] &= ~(low_bits (span) << (pos & 63));
+		done += span;
+	}
+}
+
+/*Returns the number of consecutive bits set from seq on, at most n*/
+template <typename P>
+static inline __u32 bits_run (sctp_window<P> const *win, __u64 const *map, __u32 seq, __u32 n)
+{
+	__u32 ret = 0, chunk, ones;
+	__u64 w;
+
+	while (ret < n) {
+		chunk = (n - ret < 64) ? n - ret : 64;
+		w = ~bits_get<P> (win, map, seq + ret, chunk);
+		ones = w ? __builtin_ctzll (w) : 64;
+		if (ones < chunk)
+			return ret + ones;
+		ret += chunk;
+	}
+	return n;
 }
 
 template <typename P>
@@ -34,23 +99,95 @@ static inline __u8 is_in_window (sctp_window<P> *win, __u32 seq)
 	__u32 winsize;
 	__u32 distsl;
 	__u32 disths;
-	__u32 max;
-	max = win->max_frames;
-	winsize = (win->high_seq - win->low_seq)%max;
-	disths = (win->high_seq - seq)%max;
-	distsl = (seq - win->low_seq)%max;
+	__u32 mask;
+	mask = win->mask;
+	winsize = (win->high_seq - win->low_seq) & mask;
+	disths = (win->high_seq - seq) & mask;
+	distsl = (seq - win->low_seq) & mask;
 	return ((disths <= winsize)&&(distsl < winsize));
 }
 
+/*The resend list links the unacknowledged frames of TXWIN (busy set, acked clear) in order of their last
+ *transmission. Timestamps only grow and all frames share the same rto, so this is also the order of their
+ *timeouts: frames are appended when (re)sent, unlinked when acknowledged and expire from the head.
+ *A caller whose clock reading is older than the tail's stamps the frame with the tail's time.*/
+template <typename P>
+static inline void rs_append (sctp_window<P> *win, __u32 seq, __u64 currtime)
+{
+	sctp_internal<P> *tmp;
+
+	if ((win->rs_tail != SEQ_NONE) && (get_frame<P> (win, win->rs_tail)->rtime > currtime))
+		currtime = get_frame<P> (win, win->rs_tail)->rtime;
+	tmp = get_frame<P> (win, seq);
+	tmp->rtime = currtime;
+	tmp->rs_prev = win->rs_tail;
+	tmp->rs_next = SEQ_NONE;
+	if (win->rs_tail != SEQ_NONE)
+		get_frame<P> (win, win->rs_tail)->rs_next = seq;
+	else
+		win->rs_head = seq;
+	win->rs_tail = seq;
+}
+
+template <typename P>
+static inline void rs_unlink (sctp_window<P> *win, __u32 seq)
+{
+	sctp_internal<P> *tmp;
+
+	tmp = get_frame<P> (win, seq);
+	if (tmp->rs_prev != SEQ_NONE)
+		get_frame<P> (win, tmp->rs_prev)->rs_next = tmp->rs_next;
+	else
+		win->rs_head = tmp->rs_next;
+	if (tmp->rs_next != SEQ_NONE)
+		get_frame<P> (win, tmp->rs_next)->rs_prev = tmp->rs_prev;
+	else
+		win->rs_tail = tmp->rs_prev;
+}
+
+/*A frame stamped after currtime (clock read by another thread before) has not expired*/
+template <typename P>
+static inline bool rs_expired (sctp_internal<P> const *frame, __u64 rto, __u64 currtime)
+{
+	return (currtime >= frame->rtime) && ((currtime - frame->rtime) >= rto);
+}
+
 template <typename P>
 static __u8 is_win_full (sctp_window<P> *win) {
-#ifndef WITH_CONGAV
-	return (((win->high_seq - win->low_seq)%win->max_frames) == win->max_wsize);
+	return (((win->high_seq - win->low_seq) & win->mask) == win->max_wsize);
+}
+
+/*A retransmission starts a loss episode (unless there is one already): it lasts until the frames in flight
+ *now are acknowledged, only its first loss is reported to the congestion controller*/
+template <typename P>
+static inline void start_loss_episode (sctp_window<P> *win, __u8 timeout, __u64 currtime)
+{
+	if (win->flag)
+		return;
+	win->flag = 1;
+	win->recover = win->high_seq;
+#ifdef WITH_CONGAV
+	if (timeout)
+		cc_on_timeout (&(win->cc), currtime);
+	else
+		cc_on_loss (&(win->cc), currtime);
 #else
-	return (((win->high_seq - win->low_seq)%win->max_frames) == (win->cur_wsize / sizeof (arq_frame<P>)));
+	(void) timeout;
+	(void) currtime;
 #endif
 }
 
+static inline __u32 win_mapwords (__u32 max_fr)
+{
+	return (max_fr + 63) / 64;
+}
+
+template <typename P>
+static inline size_t win_bufsize (__u32 max_fr)
+{
+	return sizeof(sctp_internal<P>)*max_fr + 2*sizeof(__u64)*win_mapwords (max_fr);
+}
+
 /*TODO: Rename malloc to kmalloc when in kernel space*/
 template <typename P>
 __s8 win_init (sctp_window<P> *win, __u32 max_fr, __u32 max_ws, __u8 side)
@@ -58,29 +195,35 @@ __s8 win_init (sctp_window<P> *win, __u32 max_fr, __u32 max_ws, __u8 side)
 	__u8 *tmp;
 	if (win)
 	{
-		/*Create buffer and store it*/
-		tmp = static_cast<__u8*>(malloc (sizeof(struct sctp_internal<P>)*max_fr));
+		/*SEQ arithmetic masks, the bitmaps need one word at least*/
+		if (!max_fr || (max_fr & (max_fr - 1)))
+			return SC_INVAL;
+
+		/*Create buffer (the bitmaps follow the frames) and store it*/
+		tmp = static_cast<__u8*>(malloc (win_bufsize<P> (max_fr)));
 		if (!tmp) return SC_NOMEM;
 
 		win->side = side;
 		win->max_frames = max_fr;
+		win->mask = max_fr - 1;
 		win->max_wsize = max_ws;
 		win->low_seq = 0;
+		win->rs_head = SEQ_NONE;
+		win->rs_tail = SEQ_NONE;
+		win->flag = 0;
 
 		if (side == SCTP_RXWIN) {
 			win->high_seq = max_ws;
 		} else {
 			win->high_seq = 0;
-#ifdef WITH_CONGAV
-			/*set wsize = 1*/
-			win->flag = 0;
-			win->cur_wsize = sizeof (arq_frame<P>);
-			win->ss_thresh = max_ws * sizeof(arq_frame<P>) / 2;
-#endif
+			/*Replaced by the controller selected at core start*/
+			cc_init (&(win->cc), SCTP_CC_AIMD, max_ws);
 		}
 
 		win->frames = (sctp_internal<P> *)tmp;
-		memset (tmp, 0, sizeof(sctp_internal<P>)*max_fr);
+		win->acked = (__u64 *)(tmp + sizeof(sctp_internal<P>)*max_fr);
+		win->busy = win->acked + win_mapwords (max_fr);
+		memset (tmp, 0, win_bufsize<P> (max_fr));
 		atomic_write (&(win->lock.lock), 0);
 		return 1;
 	}
@@ -95,21 +238,19 @@ void win_reset (sctp_window<P> *win)
 	if (win)
 	{
 		win->low_seq = 0;
+		win->rs_head = SEQ_NONE;
+		win->rs_tail = SEQ_NONE;
+		win->flag = 0;
 
 		if (win->side == SCTP_RXWIN) {
 			win->high_seq = win->max_wsize;
 		} else {
 			win->high_seq = 0;
-#ifdef WITH_CONGAV
-			/*set wsize = 1*/
-			win->flag = 0;
-			win->cur_wsize = sizeof (arq_frame<P>);
-			win->ss_thresh = win->max_wsize * sizeof(arq_frame<P>) / 2;
-#endif
+			cc_init (&(win->cc), win->cc.algo, win->max_wsize);
 		}
 
 		/*Delete buffer content if there is such a buffer*/
-		if (win->frames) memset (win->frames, 0, sizeof(sctp_internal<P>)*win->max_frames);
+		if (win->frames) memset (win->frames, 0, win_bufsize<P> (win->max_frames));
 	}
 }
 
@@ -117,13 +258,12 @@ template <typename P>
 __s32 new_frame_tx (sctp_window<P> *win, arq_frame<P> *new_frame, __u64 currtime)
 {
 	__u32 seq;
-	/*__u32 max_frames;*/
 	__s32 ret = SC_ABORT;
 	sctp_internal<P> *tmp;
 
 #ifdef WITH_CONGAV
-	if (is_win_full<P>(win) || win->flag) {
-		/*Window is full or congestion ocurred, lets get out*/
+	if (is_win_full<P>(win) || !cc_can_send (&(win->cc), (win->high_seq - win->low_seq) & win->mask)) {
+		/*Window is full or the congestion controller holds frames back, lets get out*/
 		return 0;
 	}
 #else
@@ -135,23 +275,22 @@ __s32 new_frame_tx (sctp_window<P> *win, arq_frame<P> *new_frame, __u64 currtime
 
 	seq = win->high_seq;
 
-	tmp = get_frame<P>(win, seq);
-
-	if ((!tmp->req)) {
+	if (!test_bit (win->busy, seq)) {
 		/*Success! We can append a new frame in buffer*/
 		/*Give packet the new sequence number!*/
 		sctpreq_set_seq(new_frame, seq);
 
+		tmp = get_frame<P>(win, seq);
 		tmp->time = currtime;  /*This is initialized to current timestamp*/
 		tmp->ntrans = 1;  /*After this call we will send the frame one time minimum*/
-		tmp->acked = 0;
+		tmp->zc = 0;
+		tmp->tstamp = 0;
 		tmp->req = new_frame; /*Register pointer of frame in buffer*/
-
+		set_bit (win->busy, seq);
+		rs_append<P> (win, seq, currtime);
 
 		/*Increase high_seq locally*/
-		seq++;
-		seq = seq % win->max_frames;
-		win->high_seq = seq;
+		win->high_seq = (seq + 1) & win->mask;
 		ret = 1;
 	}
 
@@ -159,191 +298,332 @@ __s32 new_frame_tx (sctp_window<P> *win, arq_frame<P> *new_frame, __u64 currtime
 }
 
 template <typename P>
-__s32 new_frame_rx (sctp_window<P> *win, arq_frame<P> *in, sctp_internal<P> *out)
+__s32 new_frames_rx (sctp_window<P> *win, arq_frame<P> **in, __u32 num, arq_frame<P> **out)
 {
 	__u32 seq;
-	__u32 high_seq;
-	__u32 max_frames;
-	__u32 slides = 0;
-	__s32 ret = 0;
-	sctp_internal<P> *tmp;
-
-	max_frames = win->max_frames;
-
-	/*If seq was invalid we have nothing to do!!*/
-	/*Seq has to be checked before calling mark_frame!!!*/
-	seq = (__u32)sctpreq_get_seq(in);
+	__u32 slides;
+	__u32 i;
+
+	/*First register all frames of the burst in the window ...*/
+	for (i = 0; i < num; i++) {
+		/*Seq has to be checked for validity before calling new_frames_rx!!!*/
+		seq = (__u32)sctpreq_get_seq(in[i]);
+
+		/*Check if seq is in window boundary and entry isnt marked already*/
+		if (!(seq & ~win->mask) && is_in_window<P>(win, seq) && !test_bit (win->acked, seq)) {
+			/*Sequencenr is in window boundary*/
+			get_frame<P> (win, seq)->resp = in[i];
+			set_bit (win->acked, seq);
+			in[i] = NULL;
+		}
+	}
 
-	tmp = get_frame<P> (win, seq);
+	/*... then slide only once over the frames held from low_seq on (till an unmarked frame is reached)*/
+	seq = win->low_seq;
+	slides = bits_run<P> (win, win->acked, seq, (win->high_seq - seq) & win->mask);
+	if (slides) {
+		for (i = 0; i < slides; i++)
+			out[i] = get_frame<P> (win, (seq + i) & win->mask)->resp;
+		bits_clear<P> (win, win->acked, seq, slides);
 
-	/*Check if seq is in window boundary and entry isnt marked already*/
-	if ((!tmp->acked) && (is_in_window<P>(win,seq))) {
+		seq = (seq + slides) & win->mask;
+		win->low_seq = seq;
+		win->high_seq = (seq + win->max_wsize) & win->mask;
+	}
 
-		/*Sequencenr is in window boundary*/
-		tmp->resp = in;
-		tmp->acked = 1;
+	return slides;
+}
 
-		/* Check if we could slide our window */
-		if (seq == win->low_seq) {
+template <typename P>
+__s32 new_frame_rx (sctp_window<P> *win, arq_frame<P> *in, arq_frame<P> **out)
+{
+	__s32 slides;
 
-			high_seq = win->high_seq;
-			/*In fact, we can slide (slide till windowsize is zero,or an unmarked frame reached)*/
-			while ((seq != high_seq)&&(tmp->acked)) {
-				/*Copy frame into outbuffer*/
-				memcpy (out, tmp, sizeof(sctp_internal<P>));
-				tmp->resp = NULL;
-				tmp->acked = 0;
+	slides = new_frames_rx<P> (win, &in, 1, out);
+	if (in) {
+		return SC_INVAL;	/*Drop frame, its out of win!!!*/
+	}
+	return slides;
+}
 
-				/*Increase counter/pointer*/
-				out++;
-				slides++;
-				seq++;
-				seq %= max_frames;
-				tmp = get_frame<P> (win, seq);
-			}
+template <typename P>
+__s32 mark_frame (sctp_window<P> *win, __u32 rACK, arq_frame<P> **out, sctp_internal<P> *last, __u64 currtime)
+{
+	__u32 seq, pos;
+	__u32 i;
+	__u32 zc_id = 0;
+	__u8 zc = 0;
+	__s32 ret;
+	sctp_internal<P> *tmp = NULL;
 
-			win->low_seq = seq;
-			win->high_seq = (seq+win->max_wsize)%max_frames;
+	/*Check if seq is in window boundary*/
+	if (!is_in_window<P>(win, rACK))
+		return SC_INVAL;	/*Drop frame, its out of win!!!*/
 
-			ret = slides;
+	/*In fact, we can slide till we reached the first unacknowledged frame*/
+	seq = win->low_seq;
+	ret = ((rACK - seq) & win->mask) + 1;
+	for (i = 0; i < (__u32) ret; i++) {
+		pos = (seq + i) & win->mask;
+		tmp = get_frame<P> (win, pos);
+		/*Selectively acknowledged frames left the resend list already*/
+		if (test_bit (win->busy, pos) && !test_bit (win->acked, pos))
+			rs_unlink<P> (win, pos);
+		/*The ids grow with each send: keep the latest one*/
+		if (tmp->zc && (!zc || ((__s32)(tmp->zc_id - zc_id) > 0))) {
+			zc = 1;
+			zc_id = tmp->zc_id;
 		}
+		out[i] = tmp->req;
+		tmp->req = NULL;
+	}
+	bits_clear<P> (win, win->busy, seq, ret);
+	bits_clear<P> (win, win->acked, seq, ret);
+	if (last) {
+		memcpy (last, tmp, sizeof(sctp_internal<P>));
+		last->req = out[ret-1];
+		last->zc = zc;
+		last->zc_id = zc_id;
+	}
+
+	if (win->flag) {
+		/*The loss episode ends with the last frame in flight at its start*/
+		if (((win->recover - seq) & win->mask) <= (__u32) ret)
+			win->flag = 0;
 	} else {
-		ret = SC_INVAL;	/*Drop frame, its out of win!!!*/
+#ifdef WITH_CONGAV
+		/*on no congestion let the controller probe for more bandwith*/
+		cc_on_ack (&(win->cc), ret, currtime);
+#else
+		(void) currtime;
+#endif
 	}
+	win->low_seq = (seq + ret) & win->mask;
 
 	return ret;
 }
 
 template <typename P>
-__s32 mark_frame (sctp_window<P> *win, __u32 rACK, sctp_internal<P> *out)
+void mark_zerocopy (sctp_window<P> *win, arq_frame<P> **frames, __u32 num, __u32 zc_id)
 {
-	__u32 seq;
-	__u32 high_seq;
-	__u32 max_frames;
-	__s32 ret = 0;
 	sctp_internal<P> *tmp;
-#ifdef WITH_CONGAV
-	__u32 cur_wsize;
-	__u32 max_wsize;
-#endif
+	__u32 i;
 
-	max_frames = win->max_frames;
+	for (i = 0; i < num; i++) {
+		tmp = get_frame<P> (win, sctpreq_get_seq (frames[i]) & win->mask);
+		if (tmp->req == frames[i]) {
+			tmp->zc = 1;
+			tmp->zc_id = zc_id;
+		}
+	}
+}
 
-	high_seq = rACK;
+template <typename P>
+void mark_tstamp (sctp_window<P> *win, arq_frame<P> **frames, __u64 const *ts, __u32 num)
+{
+	sctp_internal<P> *tmp;
+	__u32 i, seq;
+
+	for (i = 0; i < num; i++) {
+		/*Frame may have been recycled and refilled by a user meanwhile*/
+		seq = sctpreq_get_seq (frames[i]);
+		if (seq & ~win->mask)
+			continue;
+		tmp = get_frame<P> (win, seq);
+		if (tmp->req == frames[i])
+			tmp->tstamp = ts[i];
+	}
+}
 
-	/*Check if seq is in window boundary*/
-	if (is_in_window<P>(win,high_seq)) {
-
-		/*Sequencenr is in window boundary*/
-		high_seq++;
-		high_seq %= max_frames;
-		seq = win->low_seq;
-
-		/*In fact, we can slide till we reached the first unacknowledged frame*/
-		while (seq != high_seq) {
-			/*Copy frame into outbuffer*/
-			tmp = get_frame<P> (win, seq);
-			memcpy (out, tmp, sizeof(struct sctp_internal<P>));
-			tmp->req = NULL;
-			tmp->acked = 1;
-
-			/*Increase counter/pointer*/
-			out++;
-			ret++;
-			seq++;
-			seq %= max_frames;
-		}
+/*Returns the bits of the word holding bits base to base+63 which lie in [from, to)*/
+static inline __u64 range_bits (__u32 base, __u32 from, __u32 to)
+{
+	__u64 ret = ~0ULL;
 
-		win->low_seq = seq;
+	if ((to <= base) || (from >= base + 64))
+		return 0;
+	if (from > base)
+		ret &= ~low_bits (from - base);
+	if (to < base + 64)
+		ret &= low_bits (to - base);
+	return ret;
+}
 
-#ifdef WITH_CONGAV
-		if (win->flag) {
-			/*on congestion: let win become empty and set wsize = 1 (in bytes not packets) (initiate slow start)*/
-			if (win->low_seq == win->high_seq) {
-				//printf("Congestion!\n");
-				/*Window is now empty*/
-				win->ss_thresh = win->cur_wsize / 2;
-				win->cur_wsize = sizeof (arq_frame<P>);
-				win->flag = 0;
-			}
-		} else {
-			/*on no congestion do slow start or congestion avoidance to probe for more bandwith*/
-			cur_wsize = win->cur_wsize;
-			max_wsize = win->max_wsize;
-			if (cur_wsize < win->ss_thresh) {
-				/*slow start*/
-				cur_wsize += sizeof (arq_frame<P>);
-			} else {
-				/*congestion avoidance strategy*/
-				/* cur_wsize += (1-(curr_wsize/max_wsize))*packetsize */
-				cur_wsize += ((100 - (cur_wsize*100)/(max_wsize * sizeof(arq_frame<P>))) * sizeof(arq_frame<P>))/100;
-			}
-			if (cur_wsize > (max_wsize * sizeof (arq_frame<P>))) cur_wsize = max_wsize * sizeof (arq_frame<P>);
-			win->cur_wsize = cur_wsize;
-		}
-#endif
+template <typename P>
+__u32 sack_bitmap (sctp_window<P> *win, __u32 ack, __u64 *bitmap)
+{
+	__u64 bits;
+	__u32 i, lo, from, to;
+	__u32 held = 0;
+
+	/*Frames below low_seq were passed on meanwhile, ack covers them soon: bit i counts if ack+1+i is in window*/
+	lo = (win->low_seq - (ack + 1)) & win->mask;
+	if (lo < win->max_wsize) {
+		from = lo;
+		to = win->max_wsize;
 	} else {
-		ret = SC_INVAL;	/*Drop frame, its out of win!!!*/
+		from = 0;
+		to = (lo + win->max_wsize > win->max_frames) ? lo + win->max_wsize - win->max_frames : 0;
 	}
+	for (i = 0; i < P::SACK_WORDS; i++) {
+		bits = 0;
+		if (64 * i < to)
+			bits = bits_get<P> (win, win->acked, ack + 1 + 64 * i, (to - 64 * i < 64) ? to - 64 * i : 64) &
+			       range_bits (64 * i, from, to);
+		held += __builtin_popcountll (bits);
+		bitmap[i] = htobe64 (bits);
+	}
+	return held;
+}
 
+/*ATTENTION: Lock window before calling mark_sack!!!*/
+template <typename P>
+__u32 mark_sack (sctp_window<P> *win, __u32 ack, __u64 const *bitmap, __u32 nwords)
+{
+	__u64 bits;
+	__u32 i, seq;
+	__u32 ret = 0;
+
+	for (i = 0; (i < nwords) && (64 * i < win->max_wsize); i++) {
+		bits = be64toh (bitmap[i]) & low_bits (win->max_wsize - 64 * i);
+		while (bits) {
+			seq = (ack + 1 + 64 * i + __builtin_ctzll (bits)) & win->mask;
+			bits &= bits - 1;
+			/*An older SACK may report frames already checked out*/
+			if (!is_in_window<P>(win, seq) || !test_bit (win->busy, seq) || test_bit (win->acked, seq))
+				continue;
+			rs_unlink<P> (win, seq);
+			set_bit (win->acked, seq);
+			ret++;
+		}
+	}
 	return ret;
 }
 
+/*ATTENTION: Lock window before calling fast_resend_frame!!!*/
+template <typename P>
+__s32 fast_resend_frame (sctp_window<P> *win, __u32 seq, sctp_internal<P> *resend, __u64 currtime)
+{
+	sctp_internal<P> *tmp;
+
+	if ((seq & ~win->mask) || !is_in_window<P>(win, seq))
+		return 0;
+	if (!test_bit (win->busy, seq) || test_bit (win->acked, seq))
+		return 0;
+	tmp = get_frame<P> (win, seq);
+	/*Counts as transmission, the timeout of the frame restarts*/
+	tmp->ntrans++;
+	rs_unlink<P> (win, seq);
+	rs_append<P> (win, seq, currtime);
+	start_loss_episode<P> (win, 0, currtime);
+	memcpy (resend, tmp, sizeof(sctp_internal<P>));
+	return 1;
+}
+
 /*ATTENTION: Lock window before calling resend_frame!!!*/
 template <typename P>
-__s32 resend_frame (sctp_window<P> *win, sctp_internal<P> *resend, __u64 rto, __u64 currtime)
+__s32 resend_frame (sctp_window<P> *win, sctp_internal<P> *resend, __u32 max, __u64 rto, __u64 currtime)
 {
 	__u32 ret = 0;
 	__u32 seq;
-	__u32 high;
-	__u32 max;
+	__u32 last;
 
 	sctp_internal<P> *tmp;
 
-	seq = win->low_seq;
-	high = win->high_seq;
-	max = win->max_frames;
-	/*Cycle through window to find frames to be resent*/
-	while (seq != high) {
+	/*Frames resent here go to the tail again, stop after the last one linked before*/
+	last = win->rs_tail;
+	/*Only the head of the resend list may have timed out, stop at the first frame which has not*/
+	while ((ret < max) && ((seq = win->rs_head) != SEQ_NONE)) {
 		tmp = &(win->frames[seq]);
-		/*Is this frame not checked out yet?*/
-		if (tmp->req) {
-			/*Check if timeout for this packet has run out*/
-			if (((currtime - tmp->time) / rto) >= (tmp->ntrans)) {
-				tmp->ntrans++;
-				if (tmp->ntrans >= P::MAX_TRANS) {
-					fprintf (stderr, "MASTER TIMEOUT: maximum number of transmissions reached (%d)!!\n", tmp->ntrans);
-					print_stats<P>();
-					return -1;
-				}
-
-				/*Set flag to notify mark_frame of retransmit*/
-				win->flag = 1;
-				memcpy (&(resend[ret]), tmp, sizeof(sctp_internal<P>));
-				/*Increase number of frames to be resent*/
-				ret++;
-				//ret = 1;
-			}
+		if (!rs_expired<P> (tmp, rto, currtime))
+			break;
+		tmp->ntrans++;
+		if (tmp->ntrans >= P::MAX_TRANS) {
+			fprintf (stderr, "MASTER TIMEOUT: maximum number of transmissions reached (%d)!!\n", tmp->ntrans);
+			print_stats<P>();
+			return -1;
 		}
-		seq = (seq+1) % max;
+
+		start_loss_episode<P> (win, 1, currtime);
+		rs_unlink<P> (win, seq);
+		rs_append<P> (win, seq, currtime);
+		memcpy (&(resend[ret]), tmp, sizeof(sctp_internal<P>));
+		/*Increase number of frames to be resent*/
+		ret++;
+		if (seq == last)
+			break;
 	}
 
 	return ret;
 }
 
+/*ATTENTION: Lock window before calling resend_restart!!!*/
+template <typename P>
+__u32 resend_restart (sctp_window<P> *win, __u64 rto, __u64 currtime)
+{
+	__u32 ret = 0;
+	__u32 seq;
+	__u32 last;
+
+	/*Same walk as resend_frame, the frames go to the tail without a transmission*/
+	last = win->rs_tail;
+	while ((seq = win->rs_head) != SEQ_NONE) {
+		if (!rs_expired<P> (&(win->frames[seq]), rto, currtime))
+			break;
+		rs_unlink<P> (win, seq);
+		rs_append<P> (win, seq, currtime);
+		ret++;
+		if (seq == last)
+			break;
+	}
+	return ret;
+}
+
+template <typename P>
+__u64 resend_deadline (sctp_window<P> const *win, __u64 rto)
+{
+	/*The head of the resend list was transmitted first*/
+	if (win->rs_head == SEQ_NONE)
+		return TIME_NONE;
+	return win->frames[win->rs_head].rtime + rto;
+}
+
+template <typename P>
+__u8 ack_pending (sctp_window<P> *win, __u32 rACK)
+{
+	return is_in_window<P> (win, rACK);
+}
+
 #define PARAMETERISATION(Name, name)                                                               \
 	template __s8 win_init(struct sctp_window<Name>* win, __u32 max_fr, __u32 max_ws, __u8 side);  \
 	template void win_reset(struct sctp_window<Name>* win);                                        \
 	template __s32 new_frame_tx(                                                                   \
 	    struct sctp_window<Name>* win, struct arq_frame<Name>* new_frame, __u64 currtime);         \
+	template __s32 new_frames_rx(                                                                  \
+	    struct sctp_window<Name>* win, struct arq_frame<Name>** in, __u32 num,                     \
+	    struct arq_frame<Name>** out);                                                             \
 	template __s32 new_frame_rx(                                                                   \
-	    struct sctp_window<Name>* win, struct arq_frame<Name>* in,                                 \
-	    struct sctp_internal<Name>* out);                                                          \
+	    struct sctp_window<Name>* win, struct arq_frame<Name>* in, struct arq_frame<Name>** out);  \
 	template __s32 mark_frame(                                                                     \
-	    struct sctp_window<Name>* win, __u32 rACK, struct sctp_internal<Name>* out);               \
+	    struct sctp_window<Name>* win, __u32 rACK, struct arq_frame<Name>** out,                   \
+	    struct sctp_internal<Name>* last, __u64 currtime);                                         \
 	template __s32 resend_frame(                                                                   \
-	    struct sctp_window<Name>* win, struct sctp_internal<Name>* resend, __u64 rto,              \
-	    __u64 currtime);
+	    struct sctp_window<Name>* win, struct sctp_internal<Name>* resend, __u32 max, __u64 rto,   \
+	    __u64 currtime);                                                                           \
+	template __u32 resend_restart(struct sctp_window<Name>* win, __u64 rto, __u64 currtime);       \
+	template __u64 resend_deadline(struct sctp_window<Name> const* win, __u64 rto);                \
+	template __u8 ack_pending(struct sctp_window<Name>* win, __u32 rACK);                          \
+	template void mark_zerocopy(                                                                   \
+	    struct sctp_window<Name>* win, struct arq_frame<Name>** frames, __u32 num, __u32 zc_id);   \
+	template void mark_tstamp(                                                                     \
+	    struct sctp_window<Name>* win, struct arq_frame<Name>** frames, __u64 const* ts,           \
+	    __u32 num);                                                                                \
+	template __s32 fast_resend_frame(                                                              \
+	    struct sctp_window<Name>* win, __u32 seq, struct sctp_internal<Name>* resend,              \
+	    __u64 currtime);                                                                           \
+	template __u32 sack_bitmap(struct sctp_window<Name>* win, __u32 ack, __u64* bitmap);           \
+	template __u32 mark_sack(                                                                      \
+	    struct sctp_window<Name>* win, __u32 ack, __u64 const* bitmap, __u32 nwords);
 #include "sctrltp/parameters.def"
 
 } // namespace sctrltp
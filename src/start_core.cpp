@@ -63,9 +63,6 @@ int main (int argc, char **argv)
 		if (n < 0) break;
 		/*TODO: Print core stats*/
 		print_core  ();
-#ifdef WITH_PACKET_MMAP
-		print_sock_stats();
-#endif
 	}
 
 	return EXIT_SUCCESS;
@@ -84,9 +81,6 @@ void exit_handler (void) {
 	usleep(100*1000);
 	if (post_init) {
 		print_core  ();
-#ifdef WITH_PACKET_MMAP
-		print_sock_stats();
-#endif
 		SCTP_CoreDown<Parameters<>>();
 	}
 }
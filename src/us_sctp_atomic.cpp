@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <linux/futex.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <sched.h>
@@ -96,6 +97,20 @@ void cpu_relax (void)
 	__asm__ __volatile__ ( "rep;nop" : : : "memory" );
 }
 
+__u64 spin_clock (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (__u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+__u64 sctp_clock (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC_RAW, &ts);
+	return (__u64) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
 __s32 atomic_read (volatile __s32 *ptr)
 {
 	__s32 old_val;
@@ -287,8 +287,14 @@ static void do_reset (bool fpga_reset) {
 	struct sctp_alloc<P> *ptr;
 	__u64 queue;
 	__u32 offset;
+#ifdef WITH_SACK
+	struct arq_resetframe_ext resetframe;
+#else
 	struct arq_resetframe resetframe;
-	struct sockaddr_in reset_addr;
+#endif
+#ifdef WITH_ZEROCOPY
+	struct pollfd zc_pfd;
+#endif
 	memset (&tmp1, 0, sizeof (sctp_alloc<P>));
 	memset (&tmp2, 0, sizeof (sctp_alloc<P>));
 	pthread_t timer;
@@ -296,6 +302,29 @@ static void do_reset (bool fpga_reset) {
 	/*Signal to threads not to do anything while reset in progress*/
 	xchg (&(get_admin<P>()->STATUS.empty[0]), STAT_RESET);
 
+	/*RESEND may still write its copies of frames in txwin: they are recycled after it is done (it starts no new
+	 *burst while we reset)*/
+	spin_lock (&(get_admin<P>()->txwin.lock.lock));
+	while (get_admin<P>()->rs_busy) {
+		spin_unlock (&(get_admin<P>()->txwin.lock.lock));
+		sched_yield ();
+		spin_lock (&(get_admin<P>()->txwin.lock.lock));
+	}
+	spin_unlock (&(get_admin<P>()->txwin.lock.lock));
+
+#ifdef WITH_ZEROCOPY
+	/*Nobody sends anymore, but the kernel may still read from frames in txwin (and from acked ones TX holds back
+	 *for it): wait for all completions (the error queue belongs to whoever holds slock)*/
+	pthread_mutex_lock (&(get_admin<P>()->slock));
+	while ((sock_zc_reap (&(get_admin<P>()->sock)) >= 0) &&
+	       !sock_zc_done (&(get_admin<P>()->sock), get_admin<P>()->sock.zc_next - 1)) {
+		zc_pfd.fd = get_admin<P>()->sock.sd;
+		zc_pfd.events = 0; /*POLLERR: error queue is not empty*/
+		poll (&zc_pfd, 1, 1);
+	}
+	pthread_mutex_unlock (&(get_admin<P>()->slock));
+#endif
+
 	/*Acquire window locks*/
 	spin_lock (&(get_admin<P>()->txwin.lock.lock));
 	spin_lock (&(get_admin<P>()->rxwin.lock.lock));
@@ -321,7 +350,17 @@ static void do_reset (bool fpga_reset) {
 	/*set some vars to initial values again*/
 	get_admin<P>()->ACK = P::MAX_NRFRAMES-1;
 	get_admin<P>()->REQ = 0;
+	get_admin<P>()->SACK = 0;
+	get_admin<P>()->ACK_SENT = get_admin<P>()->ACK;
 	get_admin<P>()->rACK = get_admin<P>()->ACK;
+	get_admin<P>()->RETX = -1;
+	get_admin<P>()->rs_next = 0;
+	get_admin<P>()->rs_sent = 0;
+	get_admin<P>()->rs_burst = 0;
+	get_admin<P>()->rs_busy = 0;
+	get_admin<P>()->tx_busy = 0;
+	get_admin<P>()->rs_low = 0;
+	get_admin<P>()->rs_high = 0;
 
 	/*Reset windows (txwin, rxwin)*/
 	win_reset (&(get_admin<P>()->rxwin));
@@ -373,14 +412,15 @@ static void do_reset (bool fpga_reset) {
 
 	/*Send reset frame to remote host, if we have to*/
 	if (fpga_reset) {
+#ifdef WITH_SACK
+		sctpreset_init_ext(&resetframe, CFG_FEATURE_SACK);
+#else
 		sctpreset_init(&resetframe);
+#endif
 
-		memset(&reset_addr, 0, sizeof(reset_addr));
-		reset_addr.sin_family = AF_INET;
-		reset_addr.sin_port = htons(get_admin<P>()->sock.udp_port_reset);
-		reset_addr.sin_addr.s_addr = get_admin<P>()->sock.remote_ip;
-		b = sendto(get_admin<P>()->sock.sd, &resetframe, sizeof(struct arq_resetframe), /*flags*/ 0,
-		           (struct sockaddr *)&reset_addr, sizeof(reset_addr));
+		pthread_mutex_lock (&(get_admin<P>()->slock));
+		b = sock_write_reset (&(get_admin<P>()->sock), &resetframe, sizeof(resetframe));
+		pthread_mutex_unlock (&(get_admin<P>()->slock));
 		if (b <= 0) {
 			// EPERM happens if firewall rule exception is not set
 			if(errno == EPERM) {
@@ -461,6 +501,119 @@ void *SCTP_PREALLOC (void *core)
 	pthread_exit(NULL);
 }
 
+/*Returns the ACK to put on the wire, frames up to it need no ACK anymore (lock wlock or slock before!)*/
+template <typename P>
+static inline __u32 ack_take (sctp_core<P> *ad)
+{
+	__u32 ack = ad->ACK;
+
+	ad->ACK_SENT = ack;
+	return ack;
+}
+
+/*Puts the current ACK into a frame about to be written again. The kernel may still send an earlier copy from
+ *it (zerocopy), then the frame keeps its ACK (a cumulative ACK is never wrong, just old)
+ *Returns whether the frame carries the current ACK
+ *Lock slock before (nobody else writes the frame then)!*/
+template <typename P>
+static inline bool ack_refresh (sctp_core<P> *ad, arq_frame<P> *frame)
+{
+#ifdef WITH_ZEROCOPY
+	/*Zerocopy ids and completions change under slock only*/
+	if (!sock_zc_done (&(ad->sock), ad->sock.zc_next - 1))
+		return false;
+#endif
+	sctpreq_set_ack (frame, ack_take (ad));
+	return true;
+}
+
+#ifdef WITH_LOCKSTATS
+/*Time (spin_clock) the calling thread took the TX window lock*/
+static __thread __u64 wlock_since;
+#endif
+
+/*The TX window lock guards changes of the window only, sockets are written after releasing it
+ *(WITH_LOCKSTATS: hold times are counted in stats->nr_wlock_held)*/
+template <typename P>
+static inline void wlock_lock (sctp_core<P> *ad)
+{
+	spin_lock (&(ad->txwin.lock.lock));
+#ifdef WITH_LOCKSTATS
+	wlock_since = spin_clock ();
+#endif
+}
+
+template <typename P>
+static inline __s32 wlock_try_lock (sctp_core<P> *ad)
+{
+	if (!spin_try_lock (&(ad->txwin.lock.lock)))
+		return 0;
+#ifdef WITH_LOCKSTATS
+	wlock_since = spin_clock ();
+#endif
+	return 1;
+}
+
+template <typename P>
+static inline void wlock_unlock (sctp_core<P> *ad)
+{
+#ifdef WITH_LOCKSTATS
+	struct sctp_stats *stats = &(ad->inter->stats);
+	__u64 held = spin_clock () - wlock_since;
+	__u32 bucket = 0;
+
+	/*Still under the lock: no need for atomic counters*/
+	if ((held >> 8) > 0)
+		bucket = 64 - __builtin_clzll (held >> 8);
+	if (bucket >= LOCK_HIST)
+		bucket = LOCK_HIST - 1;
+	stats->nr_wlock_held[bucket]++;
+	stats->ns_wlock_held += held;
+	if (held > stats->ns_wlock_max)
+		stats->ns_wlock_max = held;
+#endif
+	spin_unlock (&(ad->txwin.lock.lock));
+}
+
+/*Makes RESEND look at its deadlines again, if deadline (sctp_clock) is earlier than the one it sleeps for
+ *(a race with RESEND only costs another wakeup, it reads all deadlines after the event)*/
+template <typename P>
+static inline void resend_wake (sctp_core<P> *ad, __u64 deadline)
+{
+	if (deadline >= ad->rs_wake)
+		return;
+	ad->rs_wake = deadline;
+	if (eventfd_write (ad->rs_event, 1) < 0)
+		SCTRL_LOG_ERROR("Could not wake RESEND (NAME: %s)", get_admin<P>()->NAME);
+}
+
+/*Ends the retransmit burst of RESEND (ATTENTION: lock txwin first)*/
+template <typename P>
+static inline void resend_burst_end (sctp_core<P> *ad)
+{
+#ifdef WITH_RTTADJ
+	struct sctp_stats *stats = &(ad->inter->stats);
+
+	/*Back off: further timeouts take twice as long, until TX samples a frame sent once again*/
+	if (stats->RTT < P::MAX_RTO) {
+		stats->RTT = (2*stats->RTT < P::MAX_RTO) ? 2*stats->RTT : P::MAX_RTO;
+		stats->nr_rto_backoff++;
+	}
+#endif
+	ad->rs_burst = 0;
+	ad->rs_next = 0;
+}
+
+/*Asks TX for an ACK (carried by the next data frame or sent alone)*/
+template <typename P>
+static inline void ack_request (sctp_core<P> *ad)
+{
+	if (!ad->REQ) {
+		ad->REQ = 1;
+		cond_signal (&(ad->inter->waketx), 1, 1);
+	}
+}
+
 /*Rx thread*/
 template <typename P>
 void *SCTP_RX (void *core)
@@ -468,7 +621,8 @@ void *SCTP_RX (void *core)
 	__s32 a;
 	__s32 b;
 	__s32 nread;
-	__u32 i, j;
+	__s32 nrecv;
+	__u32 i, j, k;
 
 	/*Fallback buffer*/
 	arq_frame<P> local_buf;
@@ -484,32 +638,55 @@ void *SCTP_RX (void *core)
 	sctp_alloc<P> out[P::MAX_NUM_QUEUES];
 	__u64 queue = 0;
 	arq_frame<P> *curr_packet = NULL;
-	sctp_internal<P> outbuf_rx[P::MAX_WINSIZ];
+	arq_frame<P> *outbuf_rx[P::MAX_WINSIZ];
 	sctp_fifo *infifo = &(ad->inter->allocrx);
 	sctp_sock *sock = &(ad->sock);
 	sctp_stats *stats = &(ad->inter->stats);
 	sctp_window<P> *outwin = &(ad->rxwin);
 	semaphore *sig = &(ad->inter->waketx);
 
+	/*Empty frames to receive a burst into and number of bytes read into each of them*/
+	arq_frame<P> *rx_frames[P::RX_BATCH];
+	__s32 rx_nread[P::RX_BATCH];
+	__u32 nfree = 0;
+	/*Frames of a burst to be registered in window (and their index in rx_frames)*/
+	arq_frame<P> *rx_cand[P::RX_BATCH];
+	__u32 rx_cand_idx[P::RX_BATCH];
+	__u32 ncand;
+
 	__s32 seq;
 	__u32 size;
 	__u32 rack;
 	__u32 rack_old;
-	__u64 data, acktime = 0;
+	__u8 new_rack;
+	__u8 new_retx;
+	__u32 dupacks = 0;
+	__u64 data;
+	__u32 pend;
+	__u32 expect;
+	__u8 ooo;
+	__u64 now;
+#ifdef WITH_TIMESTAMPING
+	__u64 rack_tstamp = 0;
+#endif
 #ifdef _SCTP_HWPOLICY
 #error "deprecated!! Leads to erroneous behaviour on HW"
 	__u32 nrpackrcvd = 0;
 #endif
 
+	static_assert(P::RX_BATCH <= SOCK_MAX_BATCH, "RX_BATCH exceeds maximum socket batch size");
+
 	if (prctl (PR_SET_NAME, "RX", NULL, NULL, NULL))
 		printf("Setting process name isn't supported on this system.\n");
 
-	memset (outbuf_rx, 0, sizeof(struct sctp_internal<P>)*P::MAX_WINSIZ);
+	memset (outbuf_rx, 0, sizeof(arq_frame<P>*)*P::MAX_WINSIZ);
 	memset (&in, 0, sizeof (struct sctp_alloc<P>));
 	memset (out, 0, sizeof (struct sctp_alloc<P>) * P::MAX_NUM_QUEUES);
 
 	ad->ACK = (P::MAX_NRFRAMES-1);
+	ad->ACK_SENT = ad->ACK;
 	ad->rACK = (P::MAX_NRFRAMES-1);
+	ad->RETX = -1;
 	rack = (P::MAX_NRFRAMES-1);
 	rack_old = rack;
 #ifndef WITH_ROUTING
@@ -521,92 +698,236 @@ void *SCTP_RX (void *core)
 
 	/*MAIN LOOP*/
 	while (1) {
-		/*Fetch pointer to empty space to receive a packet*/
-		if ((!curr_packet) || (local == 1)) {
+		/*Fetch pointers to empty space to receive a burst of packets*/
+		if (local == 1) {
 			local = 0;
+			nfree = 0;
+		}
+		while (nfree < P::RX_BATCH) {
 			if ((i = in.next) < in.num) {
 				/*We have buffers in cache*/
 				in.next++;
-				curr_packet = in.fptr[i];
+				rx_frames[nfree++] = in.fptr[i];
 			} else {
 				/*We dont have empty buffers in cache, so lets fetch new ones*/
 				b = try_fif_pop (infifo, (__u8 *)&in, inter);
-				if (b != SC_EMPTY) {
-					/*Yippey, we got frames to handle!*/
-					for (i = 0; i < in.num; i++) {
-						in.fptr[i] = static_cast<arq_frame<P>*>(get_abs_ptr (inter, in.fptr[i]));
-					}
-					in.next = 1;
-					curr_packet = in.fptr[0];
-				} else {
-					/*allocrx is empty, so we have to fall back on local buffer*/
-					local = 1;
-					curr_packet = &local_buf;
+				if (b == SC_EMPTY)
+					break;
+				/*Yippey, we got frames to handle!*/
+				for (i = 0; i < in.num; i++) {
+					in.fptr[i] = static_cast<arq_frame<P>*>(get_abs_ptr (inter, in.fptr[i]));
 				}
+				in.next = 0;
 			}
 		}
+		if (nfree == 0) {
+			/*allocrx is empty, so we have to fall back on local buffer*/
+			local = 1;
+			rx_frames[0] = &local_buf;
+			nfree = 1;
+		}
 
-		if (local == 0) assert (curr_packet >= inter->pool);
+		if (local == 0) {
+			assert (rx_frames[0] >= inter->pool);
+			/*Backends receiving into their own frames take their initial set from us*/
+			nfree -= sock_provide_rx (sock, rx_frames, nfree);
+			if (nfree == 0)
+				continue;
+		}
 
-		/*Read packet from socket*/
-		nread = sock_read (sock, curr_packet, 1);
-		if (nread == SC_ABORT) {
+		/*Read burst of packets from socket*/
+		nrecv = sock_read_batch (sock, rx_frames, rx_nread, nfree);
+		if (nrecv == SC_ABORT) {
 			SCTRL_LOG_ERROR("Read from socket failed! Aborting RX thread... (NAME: %s)", get_admin<P>()->NAME);
 			pthread_exit (NULL);
 		}
-		stats->nr_received++;
-		while (nread == SC_INVAL) {
-			stats->nr_protofault++;
-			nread = sock_read (sock, curr_packet, 1);
-			if (nread == SC_ABORT) {
-				SCTRL_LOG_ERROR("Read from socket failed! Aborting RX thread... (NAME: %s)", get_admin<P>()->NAME);
-				pthread_exit (NULL);
+		stats->nr_received += nrecv;
+		stats->nr_rx_batches++;
+
+		ncand = 0;
+		new_rack = 0;
+		new_retx = 0;
+		for (k = 0; k < (__u32)nrecv; k++) {
+			curr_packet = rx_frames[k];
+			nread = rx_nread[k];
+			if (nread == SC_INVAL) {
+				stats->nr_protofault++;
+				continue;
 			}
-			stats->nr_received++;
-		}
 
-		size = sctpsomething_get_size(curr_packet, nread);
-		if ((__u32)nread != size) {
-			SCTRL_LOG_WARN("Received bytes on-wire and sctp.size do not match: %d != %d (dropping!) "
-				     "(NAME: %s)", nread, size, get_admin<P>()->NAME);
-			continue;
-		}
-
-		/*Check if waiting for fpga reset response*/
-		if (unlikely(ad->STATUS.empty[0] == STAT_WAITRESET)) {
-			/*Checking if recived packet is config packet*/
-			if(sctpreq_get_typ(curr_packet) == PTYPE_CFG_TYPE) {
-				/*recieved config packet, setting threads to normal*/
-				xchg (&(ad->STATUS.empty[0]), STAT_NORMAL);
+			size = sctpsomething_get_size(curr_packet, nread);
+			if ((__u32)nread != size) {
+				SCTRL_LOG_WARN("Received bytes on-wire and sctp.size do not match: %d != %d (dropping!) "
+					     "(NAME: %s)", nread, size, get_admin<P>()->NAME);
+				continue;
 			}
-			/*received packet was not a config packet, check timeout*/
-			else{
-				continue; // drop all other packets
+
+			/*Check if waiting for fpga reset response*/
+			if (unlikely(ad->STATUS.empty[0] == STAT_WAITRESET)) {
+				/*Checking if recived packet is config packet*/
+				if(sctpreq_get_typ(curr_packet) == PTYPE_CFG_TYPE) {
+#ifdef WITH_SACK
+					/*FPGAs which ignored the offer in the reset frame get plain ACKs*/
+					ad->SACK = (sctpreq_get_len(curr_packet) > CFG_INFO) &&
+					           ((be64toh(sctpreq_get_pload(curr_packet)[CFG_INFO]) >> CFG_FEATURES_SHIFT) & CFG_FEATURE_SACK);
+					SCTRL_LOG_INFO("Remote %s selective acknowledgements (NAME: %s)",
+					               ad->SACK ? "supports" : "does not support", get_admin<P>()->NAME);
+#endif
+					/*recieved config packet, setting threads to normal*/
+					xchg (&(ad->STATUS.empty[0]), STAT_NORMAL);
+				}
+				/*received packet was not a config packet, check timeout*/
+				else{
+					continue; // drop all other packets
+				}
 			}
-		}
 
-		/*Check if we can operate normally*/
-		if (likely(ad->STATUS.empty[0] == STAT_NORMAL)) {
-					/*Determine attributes of packet*/
-					rack = sctpreq_get_ack (curr_packet);
+			/*Check if we can operate normally*/
+			if (likely(ad->STATUS.empty[0] == STAT_NORMAL)) {
+				/*Determine attributes of packet*/
+				rack = sctpreq_get_ack (curr_packet);
+				seq = -1;
+				if (size > sizeof(struct arq_ackframe))
+					seq = sctpreq_get_seq (curr_packet);
+
+				/*Is ACK a new remote ACK received? (passed to TX after the burst)*/
+				if (rack != rack_old) {
+					rack_old = rack;
+					new_rack = 1;
+					dupacks = 0;
+#ifdef WITH_TIMESTAMPING
+					rack_tstamp = sock->rx_tstamp[k];
+#endif
+				} else if ((seq < 0) && (++dupacks == P::DUPACK_THRESH)) {
+					/*Remote keeps acknowledging the same frame (without data): it misses the next one*/
+					xchg (&(ad->RETX), (__s32)((rack + 1) % P::MAX_NRFRAMES));
+					new_retx = 1;
+				}
 
-					/*Is ACK a new remote ACK received?*/
-					if (rack != rack_old) {
-						/*Pass new ACK to TX and wake him up*/
-						rack_old = rack;
-						/*printf("[CORE] new rack: %d\n", rack);*/
+#ifdef WITH_SACK
+				/*SACK frames have no sequence number, frames they report are not resent by TX/RESEND*/
+				if ((seq < 0) && ad->SACK && (size > sizeof(struct arq_ackframe)) &&
+				    (sctpreq_get_typ(curr_packet) == PTYPE_SACK)) {
+					wlock_lock (ad);
+					stats->nr_sacked += mark_sack (&(ad->txwin), rack, sctpreq_get_pload(curr_packet),
+					                               sctpreq_get_len(curr_packet));
+					wlock_unlock (ad);
+				}
+#endif
 
-						xchg ((__s32 *)&(ad->rACK), (__s32)rack);
+				queue = 0;
 
-						cond_signal (sig, 1, 1);
+				/*get the right queue according to packet type*/
+				for (__u64 n = 0; n < inter->unique_queue_map.size; ++n) {
+					if (sctpreq_get_typ(curr_packet) == inter->unique_queue_map.type[n]) {
+						/* queue 0 is reserved for all non-filtered packets */
+						queue = n + 1;
+						break;
 					}
-					seq = -1;
-					if (size > sizeof(struct arq_ackframe))
-						seq = sctpreq_get_seq (curr_packet);
+				}
+				outfifo = &(inter->rx_queues[queue]);
 
-					queue = 0;
+				/*First check if seq valid and there is room in buffer ... if not, drop it! do NOT insert local_buf!!*/
+				if ((seq >= 0) && (outfifo->nr_full.semval <= (__s32)(outfifo->nr_elem - P::MAX_WINSIZ)) && (local == 0)) {
+					rx_cand[ncand] = curr_packet;
+#ifdef WITH_TIMESTAMPING
+					inter->tstamp[curr_packet - inter->pool] = sock->rx_tstamp[k];
+#endif
+					rx_cand_idx[ncand] = k;
+					ncand++;
+				} else {
+					/*Congested case: We have to drop this frame :(*/
+					if (seq >= 0) stats->nr_congdrop++;
+				}
+			} else stats->nr_congdrop++;
+		}
+
+		if (new_retx && !new_rack) {
+			/*Wake TX for the fast retransmit*/
+			cond_signal (sig, 1, 1);
+		}
+
+		if (new_rack) {
+			/*Pass newest ACK to TX and wake him up*/
+			/*printf("[CORE] new rack: %d\n", rack_old);*/
+#ifdef WITH_TIMESTAMPING
+			/*TX takes rACK and its timestamp as a pair*/
+			ad->rACK_gen++;
+			storefence ();
+			ad->rACK_tstamp = rack_tstamp;
+#endif
+			xchg ((__s32 *)&(ad->rACK), (__s32)rack_old);
+#ifdef WITH_TIMESTAMPING
+			ad->rACK_gen++;
+#endif
+
+			cond_signal (sig, 1, 1);
+		}
+
+		if (ncand > 0) {
+			now = sctp_clock ();
+
+			/*A frame not following its predecessor means loss, reordering or a resend by remote*/
+			ooo = 0;
+			expect = outwin->low_seq;
+			for (k = 0; k < ncand; k++) {
+				if ((__u32) sctpreq_get_seq (rx_cand[k]) != expect) {
+					ooo = 1;
+					break;
+				}
+				expect = (expect + 1) % P::MAX_NRFRAMES;
+			}
+
+			/*Register the whole burst in window at once*/
+			b = new_frames_rx(outwin, rx_cand, ncand, outbuf_rx);
+			a = 0;
+			if (b > 0) {
+				/*There are new frames in order from remote to pass back to user*/
+				while (a < b) {
+					curr_packet = outbuf_rx[a];
+					/* Handle first reset response packet. Check for matching protocol settings.
+					 * Signal init done after successful check*/
+					if (unlikely((sctpreq_get_typ(curr_packet) == PTYPE_CFG_TYPE) && !init_done)) {
+						/* Fromating variables */
+						SCTRL_LOG_INFO("Got reset answer (NAME: %s)", get_admin<P>()->NAME);
+						std::array<std::string, 3> const resetframe_var_names = {
+						    "MAX_NRFRAMES\t", "MAX_WINSIZ\t", "MAX_PDUWORDS\t"};
+						std::array<uint64_t, 3> const resetframe_var_values_check = {
+						    P::MAX_NRFRAMES,
+						    P::MAX_WINSIZ,
+						    P::MAX_PDUWORDS,
+						};
+						bool wrong_hw_settings = false;
+
+						if (sctpreq_get_len(curr_packet) <
+							resetframe_var_values_check.size()) {
+							fprintf(stderr, "Reset frame packet size to small");
+							do_hard_exit<P>(ExitCode::FPGA_SETTINGS_MISMATCH);
+						}
+						for (j = 0; j < resetframe_var_values_check.size(); j++) {
+							data = be64toh(sctpreq_get_pload(curr_packet)[j]);
+
+							if (data == resetframe_var_values_check[j])
+								SCTRL_LOG_INFO("\t%s\t%llu\t OK!", resetframe_var_names[j].c_str(), data);
+							else {
+								SCTRL_LOG_ERROR("\t%s\t Sent by FPGA: %llu\t Expected by Host: %lu (NAME: %s)",
+									resetframe_var_names[j].c_str(), data, resetframe_var_values_check[j],
+									get_admin<P>()->NAME);
+								wrong_hw_settings = true;
+							}
+						}
+						if (wrong_hw_settings) {
+							fprintf (stderr, "ERROR: Mismatch of software and FPGA hardware settings, maybe old or experimental FPGA Bitfile\n"\
+									"If you are sure that the bitfile is correct change values in include/sctrltp/sctrltp_defines.h\n"\
+									"if not please contact a FPGA person of your choice (Christian Mauch, Eric Mueller)\n");
+							do_hard_exit<P>(ExitCode::FPGA_SETTINGS_MISMATCH);
+						}
+						// first reset answer packet handled, possible remaining packets handled normally
+						init_done = true;
+					}
 
 					/*get the right queue according to packet type*/
+					queue = 0;
 					for (__u64 n = 0; n < inter->unique_queue_map.size; ++n) {
 						if (sctpreq_get_typ(curr_packet) == inter->unique_queue_map.type[n]) {
 							/* queue 0 is reserved for all non-filtered packets */
@@ -616,127 +937,153 @@ void *SCTP_RX (void *core)
 					}
 					outfifo = &(inter->rx_queues[queue]);
 
-					/*First check if seq valid and there is room in buffer ... if not, drop it! do NOT insert local_buf!!*/
-					if ((seq >= 0) && (outfifo->nr_full.semval <= (__s32)(outfifo->nr_elem - P::MAX_WINSIZ)) && (local == 0)) {
-						b = new_frame_rx(outwin, curr_packet, outbuf_rx);
-						a = 0;
-						if (b > 0) {
-							/*There are new frames in order from remote to pass back to user*/
-							while (a < b) {
-								/* Handle first reset response packet. Check for matching protocol settings.
-								 * Signal init done after successful check*/
-								if (unlikely((sctpreq_get_typ(curr_packet) == PTYPE_CFG_TYPE) && !init_done)) {
-									/* Fromating variables */
-									SCTRL_LOG_INFO("Got reset answer (NAME: %s)", get_admin<P>()->NAME);
-									std::array<std::string, 3> const resetframe_var_names = {
-									    "MAX_NRFRAMES\t", "MAX_WINSIZ\t", "MAX_PDUWORDS\t"};
-									std::array<uint64_t, 3> const resetframe_var_values_check = {
-									    P::MAX_NRFRAMES,
-									    P::MAX_WINSIZ,
-									    P::MAX_PDUWORDS,
-									};
-									bool wrong_hw_settings = false;
-
-									if (sctpreq_get_len(curr_packet) <
-										resetframe_var_values_check.size()) {
-										fprintf(stderr, "Reset frame packet size to small");
-										do_hard_exit<P>(ExitCode::FPGA_SETTINGS_MISMATCH);
-									}
-									for (j = 0; j < resetframe_var_values_check.size(); j++) {
-										data = be64toh(sctpreq_get_pload(curr_packet)[j]);
-
-										if (data == resetframe_var_values_check[j])
-											SCTRL_LOG_INFO("\t%s\t%llu\t OK!", resetframe_var_names[j].c_str(), data);
-										else {
-											SCTRL_LOG_ERROR("\t%s\t Sent by FPGA: %llu\t Expected by Host: %lu (NAME: %s)",
-												resetframe_var_names[j].c_str(), data, resetframe_var_values_check[j],
-												get_admin<P>()->NAME);
-											wrong_hw_settings = true;
-										}
-									}
-									if (wrong_hw_settings) {
-										fprintf (stderr, "ERROR: Mismatch of software and FPGA hardware settings, maybe old or experimental FPGA Bitfile\n"\
-												"If you are sure that the bitfile is correct change values in include/sctrltp/sctrltp_defines.h\n"\
-												"if not please contact a FPGA person of your choice (Christian Mauch, Eric Mueller)\n");
-										do_hard_exit<P>(ExitCode::FPGA_SETTINGS_MISMATCH);
-									}
-									// first reset answer packet handled, possible remaining packets handled normally
-									init_done = true;
-								}
-
-								/*get the right queue according to packet type*/
-								queue = 0;
-								for (__u64 n = 0; n < inter->unique_queue_map.size; ++n) {
-									if (sctpreq_get_typ(curr_packet) == inter->unique_queue_map.type[n]) {
-										/* queue 0 is reserved for all non-filtered packets */
-										queue = n + 1;
-										break;
-									}
-								}
-								outfifo = &(inter->rx_queues[queue]);
-
-								/*Pass packet to upper layer*/
-								if ((i = out[queue].next) < PARALLEL_FRAMES) {
-									/*There is room in local_buf to check frame in*/
-									out[queue].fptr[i] = static_cast<arq_frame<P>*>(get_rel_ptr (inter, outbuf_rx[a].resp));
-									out[queue].next++;
-								} else {
-									/*Local buf totally full, so lets push it up first ...*/
-									out[queue].num = PARALLEL_FRAMES;
-									out[queue].next = 0;
-									fif_push (outfifo, (__u8 *)&out[queue], inter);
-									/*... but do not forget to register our frame*/
-									out[queue].next = 1;
-									out[queue].fptr[0] = static_cast<arq_frame<P>*>(get_rel_ptr (inter, outbuf_rx[a].resp));
-								}
-
-								a++;
-							}
+					/*Pass packet to upper layer*/
+					if ((i = out[queue].next) < PARALLEL_FRAMES) {
+						/*There is room in local_buf to check frame in*/
+						out[queue].fptr[i] = static_cast<arq_frame<P>*>(get_rel_ptr (inter, curr_packet));
+						out[queue].next++;
+					} else {
+						/*Local buf totally full, so lets push it up first ...*/
+						out[queue].num = PARALLEL_FRAMES;
+						out[queue].next = 0;
+						fif_push (outfifo, (__u8 *)&out[queue], inter);
+						/*... but do not forget to register our frame*/
+						out[queue].next = 1;
+						out[queue].fptr[0] = static_cast<arq_frame<P>*>(get_rel_ptr (inter, curr_packet));
+					}
 
-							for (queue = 0; queue < inter->unique_queue_map.size + 1; queue++) {
-								outfifo = &(inter->rx_queues[queue]);
-								/*Flush any remaining frames*/
-								if ((i = out[queue].next) > 0) {
-									/*We dont have another frame, but want to flush remaining frames*/
-									out[queue].num = i;
-									out[queue].next = 0;
-									fif_push (outfifo, (__u8 *)&out[queue], inter);
-								}
-							}
+					a++;
+				}
 
-							/*Update ACK field if window was slided*/
-							xchg ((__s32 *)&(ad->ACK), (__s32)((outwin->low_seq - 1) % outwin->max_frames));
-						}
+				for (queue = 0; queue < inter->unique_queue_map.size + 1; queue++) {
+					outfifo = &(inter->rx_queues[queue]);
+					/*Flush any remaining frames*/
+					if ((i = out[queue].next) > 0) {
+						/*We dont have another frame, but want to flush remaining frames*/
+						out[queue].num = i;
+						out[queue].next = 0;
+						fif_push (outfifo, (__u8 *)&out[queue], inter);
+					}
+				}
 
-						/*TODO: Maybe implement a different strategy if HW supports this*/
-						/*Acknowledge everything (AE Strategy)*/
-						/*Delayed acknowledgement strategy (every 100 ms)*/
-						if (ad->currtime >= (acktime + P::DELAY_ACK)) {
-							ad->REQ = 1;
-							cond_signal (sig, 1, 1);
-							acktime = ad->currtime;
-						}
+				/*Update ACK field if window was slided (the first frame to acknowledge starts the delay)*/
+				if (ad->ACK == ad->ACK_SENT)
+					ad->ACK_TIME = now;
+				xchg ((__s32 *)&(ad->ACK), (__s32)((outwin->low_seq - 1) % outwin->max_frames));
+			}
 
-						/*Frame was registered successfully, so it is passed to upper layer*/
-						if (b >= 0) {
-							stats->bytes_recv_payload += sctpreq_get_size(curr_packet);
-							stats->nr_received_payload++;
-							curr_packet = NULL;
-						} else {
-							/*sequence was valid but out of window*/
-							stats->bytes_recv_oow += sctpreq_get_size(curr_packet);
-							stats->nr_outofwin++;
-						}
-					} else {
-						/*Congested case: We have to drop this frame :(*/
-						if (seq >= 0) stats->nr_congdrop++;
-					}
-		} else stats->nr_congdrop++;
-		/*Nothing more to do, so may fetch another buffer*/
+			/*Adaptive acknowledgement: at once after frames out of sequence (remote has to learn about the gap),
+			 *ACK_EVERY frames or half the window, otherwise after DELAY_ACK (RESEND checks frames arriving in a trickle)*/
+			pend = (ad->ACK + P::MAX_NRFRAMES - ad->ACK_SENT) % P::MAX_NRFRAMES;
+			if (ooo) {
+				stats->nr_ack_ooo++;
+				ack_request (ad);
+			} else if ((pend >= P::ACK_EVERY) || (pend >= P::MAX_WINSIZ / 2)) {
+				ack_request (ad);
+			} else if ((pend > 0) && (now >= (ad->ACK_TIME + P::DELAY_ACK))) {
+				stats->nr_ack_delayed++;
+				ack_request (ad);
+			} else if (pend > 0) {
+				/*RESEND may sleep longer than the ACK may wait*/
+				resend_wake (ad, ad->ACK_TIME + P::DELAY_ACK);
+			}
+
+			for (k = 0; k < ncand; k++) {
+				curr_packet = rx_frames[rx_cand_idx[k]];
+				if (rx_cand[k] == NULL) {
+					/*Frame was registered successfully, so it is passed to upper layer*/
+					stats->bytes_recv_payload += sctpreq_get_size(curr_packet);
+					stats->nr_received_payload++;
+					rx_frames[rx_cand_idx[k]] = NULL;
+				} else {
+					/*sequence was valid but out of window*/
+					stats->bytes_recv_oow += sctpreq_get_size(curr_packet);
+					stats->nr_outofwin++;
+				}
+			}
+		}
+
+		/*Keep frames which were not passed to the window for the next burst*/
+		if (local == 0) {
+			j = 0;
+			for (k = 0; k < nfree; k++) {
+				if (rx_frames[k])
+					rx_frames[j++] = rx_frames[k];
+			}
+			nfree = j;
+		}
+		/*Nothing more to do, so may fetch more buffers*/
 	}
 	pthread_exit(NULL);
 }
 
+#ifdef WITH_SACK
+/*Sets up a SACK frame with the current ACK if RX holds frames beyond it and remote supports SACK
+ *Returns its size, 0 if a plain ACK does*/
+template <typename P>
+static __u32 sack_setup (sctp_core<P> *ad, arq_frame<P> *frame)
+{
+	__u32 ack = ack_take (ad);
+
+	/*RX does not lock its window: ACK is read first, frames it reports held were received meanwhile*/
+	loadfence ();
+	if (!ad->SACK || (sack_bitmap (&(ad->rxwin), ack, sctpreq_get_pload (frame)) == 0))
+		return 0;
+	sctpreq_set_header (frame, P::SACK_WORDS, PTYPE_SACK);
+	sctpreq_set_seq (frame, SEQ_NONE);
+	sctpreq_set_ack (frame, ack);
+	ad->inter->stats.nr_sack_sent++;
+	return sctpreq_get_size (frame);
+}
+#endif
+
+#ifdef WITH_PACING
+/*Token bucket in front of the socket: bytes on the wire (WIRE_OVERHEAD included) never exceed
+ *pace_burst + pace_rate * time; with tokens in 1/1000 bytes a rate in bytes/us adds whole tokens per ns
+ *Lock wlock before!*/
+template <typename P>
+static inline void pace_fill (sctp_core<P> *ad)
+{
+	__u64 now = spin_clock ();
+	__u64 idle = now - ad->pace_time;
+
+	/*Any rate refills the bucket within pace_burst * 1000 ns, longer idle times must not overflow*/
+	if (idle > ad->pace_burst * 1000)
+		idle = ad->pace_burst * 1000;
+	ad->pace_tokens += (__s64)(idle * ad->pace_rate);
+	if (ad->pace_tokens > (__s64)(ad->pace_burst * 1000))
+		ad->pace_tokens = (__s64)(ad->pace_burst * 1000);
+	ad->pace_time = now;
+}
+
+/*Tokens a datagram of size bytes costs*/
+template <typename P>
+static inline __s64 pace_cost (sctp_core<P> const *ad, __u32 size)
+{
+	return ad->pace_rate ? (__s64)(size + WIRE_OVERHEAD) * 1000 : 0;
+}
+
+/*Reads the number the environment variable name holds into val, which stays as is if the variable is unset
+ *Returns 0, SC_INVAL if it is no plain number or lies outside min..max*/
+static __s32 pace_env (char const *name, __u64 min, __u64 max, __u64 *val)
+{
+	char const *str = getenv (name);
+	char *end;
+	unsigned long long tmp;
+
+	if (!str || !*str)
+		return 0;
+	errno = 0;
+	tmp = strtoull (str, &end, 0);
+	if ((*str < '0') || (*str > '9') || errno || *end || (tmp < min) || (tmp > max)) {
+		SCTRL_LOG_ERROR ("Invalid %s=%s (expected %llu..%llu)", name, str, min, max);
+		return SC_INVAL;
+	}
+	*val = tmp;
+	return 0;
+}
+#endif
+
 /*Tx thread*/
 template <typename P>
 void *SCTP_TX (void *core)
@@ -751,35 +1098,78 @@ void *SCTP_TX (void *core)
 	arq_frame<P> *curr_packet = NULL;
 	struct sctp_fifo *outfifo = &(ad->inter->alloctx);
 	sctp_window<P> *outwin = &(ad->txwin);
-	__vs32 *wlock = &(ad->txwin.lock.lock);
 	struct sctp_stats *stats = &(ad->inter->stats);
 	struct sctp_sock *sock = &(ad->sock);
 	struct semaphore *sig = &(ad->inter->waketx);
-	sctp_internal<P> outbuf_tx[P::MAX_WINSIZ];
+	arq_frame<P> *outbuf_tx[P::MAX_WINSIZ];
+	sctp_internal<P> acked_last; /*newest frame checked out by mark_frame*/
+	sctp_internal<P> retx;
+	__u32 retxsize;
+	arq_frame<P> *burst[P::TX_BURST];
+	__u32 burst_size[P::TX_BURST];
+	__u32 nburst;
+	bool do_arq_reset;
+#ifdef WITH_ZEROCOPY
+	/*Acked frames the kernel still sends from (zerocopy), returned in order once completed*/
+	arq_frame<P> *zc_held[P::ALLOCTX_BUFSIZE];
+	__u32 zc_held_id[P::ALLOCTX_BUFSIZE];
+	__u32 zc_head = 0;
+	__u32 zc_count = 0;
+	__u32 zc_next;
+	__u32 zc_last;
+	struct pollfd zc_pfd;
+#endif
+#ifdef WITH_TIMESTAMPING
+	arq_frame<P> *ts_frames[P::TX_BURST];
+	__u64 ts_val[P::TX_BURST];
+	__u32 nts;
+	__u64 curr_rack_tstamp = 0;
+	__u32 rack_gen;
+#endif
+#ifdef WITH_PACING
+	bool paced;
+	__s64 pace_need;
+	__u64 pace_start;
+	struct timespec pace_ts;
+#endif
 
 	struct arq_ackframe ackpacket;
+	__s32 ackreq;
+#ifdef WITH_SACK
+	arq_frame<P> sackpacket;
+	__u32 sacksize;
+#endif
 
-	__u32 size;
 	__u32 acksize;
 	__u32 i;
 
 	__u32 curr_rack = P::MAX_NRFRAMES-1;
 	__u32 old_rack = P::MAX_NRFRAMES-1;
+	__u64 now;
+	__u64 wake;
 
 #ifdef WITH_RTTADJ
 	__s64 mRTT;
 	__s64 err;
-	__s64 avg = P::MAX_RTO;
-	__s64 dev = P::TO_RES;
+	__s64 avg = -1; /*no sample yet*/
+	__s64 dev = 0;
 	__s64 res;
 #endif
 
+	static_assert(P::TX_BURST <= SOCK_MAX_BATCH, "TX_BURST exceeds maximum socket batch size");
+
 	if (prctl (PR_SET_NAME, "TX", NULL, NULL, NULL))
 		printf("Setting process name isn't supported on this system.\n");
+#ifdef WITH_PACING
+	/*Waits for the token bucket last a few frames only, the default timer slack (50us) would spoil the rate*/
+	if (prctl (PR_SET_TIMERSLACK, 1, NULL, NULL, NULL))
+		SCTRL_LOG_WARN ("Could not reduce timer slack of TX, pacing may fall short of its rate");
+#endif
 
 	memset (&in, 0, sizeof (struct sctp_alloc<P>));
 	memset (&out, 0, sizeof (struct sctp_alloc<P>));
 	memset (&ackpacket, 0, sizeof (struct arq_ackframe));
+	memset (&acked_last, 0, sizeof (struct sctp_internal<P>));
 	acksize = sizeof(struct arq_ackframe);
 
 	SCTRL_LOG_INFO("TX UP");
@@ -788,17 +1178,100 @@ void *SCTP_TX (void *core)
 	while (1) {
 		/*Check, if we are allowed to operate normally*/
 		if (likely(ad->STATUS.empty[0] == STAT_NORMAL)) {
-			/*Try to fetch Paket, if old one was processed before*/
-			if (curr_packet == NULL) {
-				infifo = &(inter->tx_queue);
-				if ((i = in.next) < in.num) {
-					/*We have a frame in local cache*/
-					in.next++;
-					curr_packet = in.fptr[i];
-				} else {
-					/*We dont have an unprocessed frame, so lets fetch new ones*/
-					b = try_fif_pop (infifo, (__u8 *)&in, inter);
-					if (b != SC_EMPTY) {
+			/*Update values from RX*/
+#ifdef WITH_TIMESTAMPING
+			/*The timestamp has to belong to the ACK we take, RX may publish a newer one meanwhile*/
+			do {
+				rack_gen = ad->rACK_gen;
+				loadfence ();
+				curr_rack = ad->rACK;
+				curr_rack_tstamp = ad->rACK_tstamp;
+				loadfence ();
+			} while ((rack_gen & 1) || (rack_gen != ad->rACK_gen));
+#else
+			curr_rack = ad->rACK;
+#endif
+			do_arq_reset = false;
+			nburst = 0;
+#ifdef WITH_PACING
+			paced = false;
+			pace_need = 0;
+#endif
+
+#ifdef WITH_TIMESTAMPING
+			/*Collect the kernel's TX timestamps before frames leave the window (a frame may be recycled already, mark_tstamp checks).
+			 *Writes of RESEND read the error queue as well, it belongs to whoever holds slock*/
+			while (curr_rack != old_rack) {
+				pthread_mutex_lock (&(ad->slock));
+				nts = sock_tx_tstamps (sock, (void **) ts_frames, ts_val, P::TX_BURST);
+				pthread_mutex_unlock (&(ad->slock));
+				if (nts == 0)
+					break;
+				wlock_lock (ad);
+				mark_tstamp (outwin, ts_frames, ts_val, nts);
+				wlock_unlock (ad);
+			}
+#endif
+#ifdef WITH_ZEROCOPY
+			/*Collect send completions, if we are about to give frames back*/
+			if ((curr_rack != old_rack) || (zc_count > 0)) {
+				pthread_mutex_lock (&(ad->slock));
+				sock_zc_reap (sock);
+				pthread_mutex_unlock (&(ad->slock));
+			}
+#endif
+
+			/*Under the lock the window changes only, the socket is written after unlocking*/
+			wlock_lock (ad);
+			/*Read the clock under the lock: frames RESEND stamped meanwhile must not lie in our future*/
+			now = sctp_clock ();
+#ifdef WITH_PACING
+			pace_fill (ad);
+#endif
+			/*Check, if we can slide our window (RESEND writes copies of frames in it meanwhile: it signals us when done)*/
+			if ((curr_rack != old_rack) && !ad->rs_busy) {
+				a = mark_frame (outwin, curr_rack, outbuf_tx, &acked_last, now);
+				old_rack = curr_rack;
+				if ((a > 0) && ad->rs_sent) {
+					/*An ACK sooner than half a round trip after the retransmit burst started answers the original frames*/
+					if ((now - ad->rs_start) < stats->srtt / 2)
+						stats->nr_resent_spurious += ad->rs_sent;
+					ad->rs_sent = 0;
+					/*The remote got frames the burst did not resend: the others were delayed rather than lost,
+					 *the ones which did not get their slot yet wait a full timeout again*/
+					if (ad->rs_burst &&
+					    (((outwin->low_seq - ad->rs_low) & outwin->mask) > ((ad->rs_high - ad->rs_low) & outwin->mask) + 1)) {
+						stats->nr_resend_stopped += resend_restart (outwin, stats->RTT, now);
+						resend_burst_end (ad);
+					}
+				}
+			}
+			/*Remote reported a missing frame by duplicate ACKs: resend it without waiting for its timeout (unless
+			 *RESEND writes frames meanwhile, it may be one of them). Its ACK is set right before it is written*/
+			retxsize = 0;
+			if (unlikely(ad->RETX >= 0) && !ad->rs_busy &&
+			    (fast_resend_frame (outwin, (__u32) xchg (&(ad->RETX), -1), &retx, now) > 0)) {
+				retxsize = sctpreq_get_size (retx.req);
+#ifdef WITH_PACING
+				/*Resends are never delayed, new frames wait for them*/
+				ad->pace_tokens -= pace_cost (ad, retxsize);
+#endif
+			}
+
+			/*Register as many new frames as the window allows and send them as one burst*/
+			while (nburst < P::TX_BURST) {
+				/*Try to fetch Paket, if old one was processed before*/
+				if (curr_packet == NULL) {
+					infifo = &(inter->tx_queue);
+					if ((i = in.next) < in.num) {
+						/*We have a frame in local cache*/
+						in.next++;
+						curr_packet = in.fptr[i];
+					} else {
+						/*We dont have an unprocessed frame, so lets fetch new ones*/
+						b = try_fif_pop (infifo, (__u8 *)&in, inter);
+						if (b == SC_EMPTY)
+							break;
 						/*Yippey, we got frames to handle!*/
 						for (i = 0; i < in.num; i++) {
 							in.fptr[i] = static_cast<arq_frame<P>*>(get_abs_ptr (inter, in.fptr[i]));
@@ -807,243 +1280,498 @@ void *SCTP_TX (void *core)
 						curr_packet = in.fptr[0];
 					}
 				}
-			}
 
-			/*Update values from RX*/
-			curr_rack = ad->rACK;
+//				TODO check for: sctpreq_get_pload(curr_packet)[0] == htobe64(HW_HOSTARQ_MAGICWORD)) {
+				/* Check for ARQ reset command (frames collected so far are sent first) */
+				if (sctpreq_get_typ(curr_packet) == PTYPE_DO_ARQRESET && sctpreq_get_pload(curr_packet)[0] == htobe64(HW_HOSTARQ_MAGICWORD)) {
+					curr_packet = NULL;
+					do_arq_reset = true;
+					break;
+				}
 
-			if (curr_packet == NULL) {
-				spin_lock (wlock);
-				/*Check, if we can slide our window*/
-				if (curr_rack != old_rack) {
-					a = mark_frame (outwin, curr_rack, outbuf_tx);
-					old_rack = curr_rack;
+#ifdef WITH_PACING
+				/*Bucket is empty, frame is kept until TX slept long enough for it (and some more)*/
+				if (ad->pace_tokens < pace_cost (ad, sctpreq_get_size (curr_packet))) {
+					paced = true;
+					pace_need = pace_cost (ad, sctpreq_get_size (curr_packet));
+					if (pace_need < (__s64)(ad->pace_burst * 1000 / 2))
+						pace_need = (__s64)(ad->pace_burst * 1000 / 2);
+					pace_need -= ad->pace_tokens;
+					break;
 				}
+#endif
 
-				/*We do not have a packet for transmission, so we check on a possible ACK transmission*/
-				if (ad->REQ) {
-					/*Indeed, we set up an ACK frame and transmit it*/
-					sctpack_set_ack (&ackpacket, ad->ACK);
-					ad->REQ = 0;
-					b = sock_write (sock, (struct arq_frame<P> *)&ackpacket, acksize);
+				/*Try to put new frame into window*/
+				b = new_frame_tx (outwin, curr_packet, now);
+
+				if (unlikely(b == SC_ABORT)) {
+					SCTRL_LOG_ERROR("Could not register frame in window (NAME: %s)", get_admin<P>()->NAME);
+					pthread_exit(NULL);
+				}
+
+				/*Window is full, frame is kept for the next iteration*/
+				if (b <= 0)
+					break;
+
+				/* Send Frame with ACK (ACK frames are suppressed below)*/
+				sctpreq_set_ack (curr_packet, ack_take (ad));
+				burst[nburst] = curr_packet;
+				burst_size[nburst] = sctpreq_get_size(curr_packet);
+#ifdef WITH_PACING
+				ad->pace_tokens -= pace_cost (ad, burst_size[nburst]);
+#endif
+				nburst++;
+				curr_packet = NULL;
+			}
+			/*RESEND sleeps for good while nothing is in flight or the remote ACK has not been taken yet: tell it
+			 *about the first frame (after unlocking)*/
+			wake = resend_deadline (outwin, stats->RTT);
+			if (wake < ad->rs_next)
+				wake = ad->rs_next;
+
+			/*New frames carry the ACK, otherwise it is sent alone if requested*/
+			ackreq = ad->REQ;
+			ad->REQ = 0;
+			if (nburst > 0) {
+				if (ackreq)
+					stats->nr_ack_piggybacked++;
+			} else if (ackreq) {
+				sctpack_set_ack (&ackpacket, ack_take (ad));
+				stats->nr_ack_sent++;
+			}
+#ifdef WITH_SACK
+			/*Report frames held out of order, if remote understands*/
+			sacksize = 0;
+			if (ackreq)
+				sacksize = sack_setup (ad, &sackpacket);
+#endif
+			/*RESEND must not write frames before we did (nor set their ACK meanwhile)*/
+			if ((retxsize > 0) || (nburst > 0))
+				ad->tx_busy = 1;
+			wlock_unlock (ad);
+			resend_wake (ad, wake);
+
+			/*Only TX gives frames back after their ACK (not while RESEND writes them), so they stay valid until written.
+			 *RESEND writes in turns with us*/
+			if ((retxsize > 0) || (nburst > 0) || ackreq) {
+				b = 0;
+#ifdef WITH_ZEROCOPY
+				zc_next = zc_last = 0;
+#endif
+				pthread_mutex_lock (&(ad->slock));
+				if (retxsize > 0) {
+					ack_refresh (ad, retx.req);
+					b = sock_write (sock, retx.req, retxsize);
 					if (b<0) {
-						SCTRL_LOG_ERROR("Could not send ack (write to socket failed for NAME: %s)", get_admin<P>()->NAME);
+						pthread_mutex_unlock (&(ad->slock));
+						SCTRL_LOG_ERROR("Could not resend frame (write to socket failed for NAME: %s)", get_admin<P>()->NAME);
 						pthread_exit(NULL);
 					}
+					stats->nr_resent_fast++;
+					stats->bytes_sent_resend += retxsize;
+					stats->bytes_sent += retxsize;
 				}
-				spin_unlock (wlock);
-
-				if (a <= 0) {
-					/*There is really nothing to do for us, so we wait :)*/
-					cond_wait (sig, 1);
+				if (nburst > 0) {
+					/*Frames were registered in window, lets send them*/
+#ifdef WITH_ZEROCOPY
+					zc_next = sock->zc_next;
+#endif
+					b = sock_write_batch (sock, burst, burst_size, nburst);
+#ifdef WITH_ZEROCOPY
+					zc_last = (b >= 0) ? sock->zc_next : zc_next;
+#endif
+#ifdef WITH_SACK
+					/*The ACK was piggybacked, frames held out of order still need a SACK frame*/
+					if ((b >= 0) && (sacksize > 0))
+						b = sock_write (sock, &sackpacket, sacksize);
+#endif
+				} else if (ackreq) {
+#ifdef WITH_SACK
+					if (sacksize > 0)
+						b = sock_write (sock, &sackpacket, sacksize);
+					else
+#endif
+					b = sock_write (sock, (struct arq_frame<P> *)&ackpacket, acksize);
+				}
+				pthread_mutex_unlock (&(ad->slock));
+				if (b<0) {
+					if (nburst > 0)
+						SCTRL_LOG_ERROR("Could not write data to socket (NAME: %s)", get_admin<P>()->NAME);
+					else
+						SCTRL_LOG_ERROR("Could not send ack (write to socket failed for NAME: %s)", get_admin<P>()->NAME);
+					pthread_exit(NULL);
+				}
+				if ((retxsize > 0) || (nburst > 0)) {
+					wlock_lock (ad);
+#ifdef WITH_ZEROCOPY
+					/*Kernel sends from the frames until completion, they are held after their ACK*/
+					if (zc_last != zc_next)
+						mark_zerocopy (outwin, burst, nburst, zc_last - 1);
+#endif
+					ad->tx_busy = 0;
+					wlock_unlock (ad);
 				}
-			} else {
-				/*Handle Packet by type*/
-//				TODO check for: sctpreq_get_pload(curr_packet)[0] == htobe64(HW_HOSTARQ_MAGICWORD)) {
-						spin_lock (wlock);
-						/* Check for ARQ reset command */
-						if (sctpreq_get_typ(curr_packet) == PTYPE_DO_ARQRESET && sctpreq_get_pload(curr_packet)[0] == htobe64(HW_HOSTARQ_MAGICWORD)) {
-							SCTRL_LOG_INFO("Got reset command, resetting FPGA (NAME: %s)...", get_admin<P>()->NAME);
-							curr_packet = NULL;
-							spin_unlock (wlock);
-							do_reset<P>(true);
-							continue;
-						}
-
-						/*Check, if we can slide our window*/
-						if (curr_rack != old_rack) {
-							a = mark_frame (outwin, curr_rack, outbuf_tx);
-							old_rack = curr_rack;
-						}
-
-						/*Try to put new frame into window*/
-						b = new_frame_tx (outwin, curr_packet, ad->currtime);
-
-						if (unlikely(b == SC_ABORT)) {
-							SCTRL_LOG_ERROR("Could not register frame in window (NAME: %s)", get_admin<P>()->NAME);
-							pthread_exit(NULL);
-						}
 
-						if (b > 0) {
-							/*Frame was registered in window, lets send it*/
-							size = sctpreq_get_size(curr_packet);
-							/* Send Frame with ACK and delete signal if necessary
-							 * to suppress transmission of ACK frames*/
-							sctpreq_set_ack (curr_packet, ad->ACK);
-							ad->REQ = 0;
-							b = sock_write (sock, curr_packet, size);
-							assert(b % 4 == 0); // assert on alignment
-							spin_unlock (wlock);
+				/*Updating statistics (bytes_sent)*/
+				for (i = 0; i < nburst; i++) {
 #ifdef DEBUG
-							debug_write (sock, curr_packet, size);
+					debug_write (sock, burst[i], burst_size[i]);
 #endif
-							if (b<0) {
-								SCTRL_LOG_ERROR("Could not write data to socket (NAME: %s)", get_admin<P>()->NAME);
-								pthread_exit(NULL);
-							}
+					stats->bytes_sent += burst_size[i];
+					stats->bytes_sent_payload += burst_size[i];
+				}
+			}
 
-							/*Updating statistics (bytes_sent)*/
-							stats->bytes_sent += size;
-							stats->bytes_sent_payload += size;
-							curr_packet = NULL;
-						} else {
-							// FIXME: will be done in next iteration anyway?
-							/*Frame wasnt registered in window, so may transmit an ACK frame*/
-							if (ad->REQ) {
-								/*Indeed, we set up an ACK frame and transmit it*/
-								sctpack_set_ack (&ackpacket, ad->ACK);
-								ad->REQ = 0;
-								b = sock_write (sock, (struct arq_frame<P> *)&ackpacket, acksize);
-								if (b<0) {
-									SCTRL_LOG_ERROR("Could not send ack (write to socket failed for NAME: %s)", get_admin<P>()->NAME);
-									pthread_exit(NULL);
-								}
-							}
-							spin_unlock (wlock);
-							if (a <= 0) {
-								/*There is really nothing to do for us, so we wait :)*/
-								cond_wait (sig, 1);
-								sched_yield();
-							}
-						}
+			if (do_arq_reset) {
+				SCTRL_LOG_INFO("Got reset command, resetting FPGA (NAME: %s)...", get_admin<P>()->NAME);
+				do_reset<P>(true);
+				continue;
+			}
+
+#ifdef WITH_PACING
+			if (paced) {
+				/*Sleep (the rate is known, no need to spin) until the bucket is half full: sending frame by frame costs a wakeup each*/
+				pace_ts.tv_sec = (pace_need / ad->pace_rate) / 1000000000LL;
+				pace_ts.tv_nsec = (pace_need / ad->pace_rate) % 1000000000LL;
+				pace_start = spin_clock ();
+				clock_nanosleep (CLOCK_MONOTONIC, 0, &pace_ts, NULL);
+				stats->nr_paced++;
+				stats->ns_paced += spin_clock () - pace_start;
+			} else
+#endif
+			if ((nburst == 0) && (a <= 0)) {
+#ifdef WITH_BUSY_POLL
+				/*Spin for new frames (if window is open) or a moving remote ACK before we sleep*/
+				if (P::BUSY_POLL_TX > 0) {
+					__u64 start = spin_clock ();
+					__u64 spin_now = start;
+					while ((spin_now - start) < P::BUSY_POLL_TX * 1000ULL) {
+						if ((ad->rACK != old_rack) || ad->REQ || (ad->RETX >= 0) ||
+						    ((curr_packet == NULL) && ((in.next < in.num) || (infifo->nr_full.semval > 0))))
+							break;
+						cpu_relax ();
+						spin_now = spin_clock ();
+					}
+					stats->ns_spin_tx += spin_now - start;
+					if ((spin_now - start) < P::BUSY_POLL_TX * 1000ULL)
+						continue;
+				}
+#endif
+#ifdef WITH_ZEROCOPY
+				/*Frames are held back, users may wait for them: wait for completions instead*/
+				if (zc_count > 0) {
+					zc_pfd.fd = sock->sd;
+					zc_pfd.events = 0; /*POLLERR: error queue is not empty*/
+					poll (&zc_pfd, 1, 1);
+					continue;
+				}
+#endif
+				/*There is really nothing to do for us, so we wait :)*/
+				cond_wait (sig, 1);
+				/*Window was full, give RX a chance to update the remote ACK*/
+				if (curr_packet)
+					sched_yield();
 			}
 
 #ifdef WITH_RTTADJ
+			/*Karn: the ACK of a retransmitted frame may answer any of its copies, only frames sent once give a sample*/
 #ifdef WITH_CONGAV
 			/* don't update rtt if congestion occurs... it will rise to MAX otherwise */
-			if (a > 0 && !outwin->flag) {
+			if ((a > 0) && (acked_last.ntrans == 1) && !outwin->flag) {
 #else
-			if (a > 0) {
+			if ((a > 0) && (acked_last.ntrans == 1)) {
 #endif // WITH_CONGAV
 				/*Measure difference between last transmitted and already acked packet and current time*/
-				mRTT = ad->currtime - outbuf_tx[a-1].time;
-
-				/*Adjusting round trip time with measured one*/
-				err = (mRTT - avg);
-				avg += (err / 8);
-				err = llabs(err);
+				mRTT = now - acked_last.time;
+#ifdef WITH_TIMESTAMPING
+				/*Kernel timestamps of the frame leaving and the ACK arriving (if taken by the same clock)*/
+				if (acked_last.tstamp && curr_rack_tstamp && !((acked_last.tstamp ^ curr_rack_tstamp) & SOCK_TS_HW) &&
+				    (curr_rack_tstamp > acked_last.tstamp))
+					mRTT = (curr_rack_tstamp - acked_last.tstamp) / 1000;
+#endif
 
-				dev += ((err - dev) / 4);
-				if (size_t(dev) < P::TO_RES)
-					dev = P::TO_RES;
-				res = avg + 4*dev;
+				/*Adjusting round trip time with measured one (RFC 6298)*/
+				if (avg < 0) {
+					avg = mRTT;
+					dev = mRTT / 2;
+				} else {
+					err = (mRTT - avg);
+					avg += (err / 8);
+					err = llabs(err);
+					dev += ((err - dev) / 4);
+				}
+				/*Deviations below the timer resolution do not count*/
+				res = avg + ((4*dev > __s64(P::TO_RES)) ? 4*dev : __s64(P::TO_RES));
 				if (res < __s64(P::MIN_RTO))
 					res = P::MIN_RTO;
 				if (res > __s64(P::MAX_RTO))
 					res = P::MAX_RTO;
 
-				/*Put new value into statistics field*/
+				/*Put new values into statistics fields, this also ends a backoff of RESEND*/
+				stats->srtt = (__u64)avg;
+				stats->rttvar = (__u64)dev;
 				stats->RTT = (__u64)res;
 			}
 #endif
 
 			/*Push checked out frames to alloc queue*/
 			while (a > 0) {
-				push_frames (outfifo, &out, outbuf_tx[a-1].req, 0);
+#ifdef WITH_ZEROCOPY
+				/*The kernel may still read from these frames, hold them until the latest send completed*/
+				if (acked_last.zc && !sock_zc_done (sock, acked_last.zc_id)) {
+					i = (zc_head + zc_count) % P::ALLOCTX_BUFSIZE;
+					zc_held[i] = outbuf_tx[a-1];
+					zc_held_id[i] = acked_last.zc_id;
+					zc_count++;
+					a--;
+					continue;
+				}
+#endif
+				push_frames (outfifo, &out, outbuf_tx[a-1], 0);
 				a--;
 			}
+#ifdef WITH_ZEROCOPY
+			while ((zc_count > 0) && sock_zc_done (sock, zc_held_id[zc_head])) {
+				push_frames (outfifo, &out, zc_held[zc_head], 0);
+				zc_head = (zc_head + 1) % P::ALLOCTX_BUFSIZE;
+				zc_count--;
+			}
+#endif
 		}
 		/*Nothing to do here anymore, so lets fetch another packet*/
 	}
 	pthread_exit(NULL);
 }
 
-/* This thread periodically checks if there is an old packet, which has to be resend
- * TODO: Maybe set up another rtc/hpet timer for this thread*/
+/* This thread resends frames whose ACK is overdue and requests ACKs RX delayed too long. It sleeps on
+ * ad->rs_timer, armed for the earliest of these deadlines, and not at all if there is none. TX and RX
+ * report earlier deadlines by ad->rs_event (see resend_wake)*/
 template <typename P>
 void *SCTP_RESEND (void *core)
 {
 	struct sctp_core<P> *ad = (sctp_core<P>*) core;
 	struct sctp_window<P> *txwin = &(ad->txwin);
 	struct sctp_stats *stats = &(ad->inter->stats);
-	__vs32 *wlock = &(ad->txwin.lock.lock);
 	struct sctp_sock *sock = &(ad->sock);
 	struct sctp_internal<P> resend[P::MAX_NRFRAMES];
 	struct arq_frame<P> *packet;
+	struct arq_frame<P> *burst[P::TX_BURST];
+	__u32 burst_size[P::TX_BURST];
+	__u32 nburst;
+#ifdef WITH_ZEROCOPY
+	__u32 zc_next;
+	__u32 zc_last;
+#endif
 	__s32 ret;
-	__u32 size;
 	__u32 a;
+	__u32 i;
 	__s32 b;
-	__u64 time2wait = P::MAX_RTO;
-#ifndef WITH_HPET
-	struct timespec towait;
-	struct timespec remain;
-	towait.tv_sec = 0;
-	towait.tv_nsec = P::TO_RES * 1000;
-#endif
+	__u64 now;
+	__u64 deadline;
+	__u64 next;
+	__u64 expired;
+	struct pollfd pfd[2];
+	struct itimerspec its;
+	__s32 ackreq = 0;
+	bool acked;
 
 	if (prctl (PR_SET_NAME, "RETRANSMIT", NULL, NULL, NULL))
 		printf("Setting process name isn't supported on this system.\n");
 
-	ad->inter->stats.RTT = P::MAX_RTO;
+	ad->inter->stats.RTT = P::INIT_RTO;
 
 	SCTRL_LOG_INFO ("RESEND UP");
 
+	pfd[0].fd = ad->rs_timer;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = ad->rs_event;
+	pfd[1].events = POLLIN;
+	memset (&its, 0, sizeof(struct itimerspec));
+
 	/*MAIN LOOP*/
-	/*NOTE: Check state here (if Core is up etc)*/
 	while (1) {
-		/*Sleep a defined time*/
-#ifndef WITH_HPET
-		nanosleep(&towait, &remain);
-#else
-		timer_poll (&(ad->txtimer));
+		/*Sleep until our next deadline or until TX/RX report an earlier one*/
+		if ((poll (pfd, 2, -1) < 0) && (errno != EINTR)) {
+			SCTRL_LOG_ERROR("Could not wait for resend timer (NAME: %s)", get_admin<P>()->NAME);
+			pthread_exit(NULL);
+		}
+		if (pfd[0].revents & POLLIN)
+			(void) !read (ad->rs_timer, &expired, sizeof(expired));
+		if (pfd[1].revents & POLLIN)
+			(void) !read (ad->rs_event, &expired, sizeof(expired));
+		now = sctp_clock ();
+		ad->currtime = now;
+		stats->nr_resend_wakeups++;
+
+#ifdef WITH_BPF
+		/*Publish the kernel's filter drops once per wakeup*/
+		sock_filter_stats (sock);
 #endif
 
-		/*Update current time*/
-		ad->currtime += P::TO_RES;
-
-		/*Update remaining wait time*/
-		if (time2wait > P::TO_RES)
-			time2wait -= P::TO_RES;
-		else
-			time2wait = 0;
+		/*TX may hold the window (or wait to), try again soon instead of spinning*/
+		deadline = now + P::TO_RES;
+		ret = 0;
+		if (wlock_try_lock (ad)) {
+			/*Once more under the lock, TX may have stamped frames since (the filter stats above may block)*/
+			now = sctp_clock ();
+			deadline = TIME_NONE;
+			/*Check if we can operate normally*/
+			if (likely(ad->STATUS.empty[0] == STAT_NORMAL)) {
+				/*Frames arriving in a trickle are acknowledged after DELAY_ACK*/
+				if ((ad->ACK != ad->ACK_SENT) && !ad->REQ) {
+					if (now >= (ad->ACK_TIME + P::DELAY_ACK)) {
+						stats->nr_ack_delayed++;
+						ack_request (ad);
+					} else {
+						deadline = ad->ACK_TIME + P::DELAY_ACK;
+					}
+				}
 
-		if (time2wait > 0) {
-			sched_yield();
-			continue; /* still have to wait some time ... */
-		} else {
-			time2wait = ad->inter->stats.RTT;
+				/*Frames the remote acknowledged are never resent: TX takes them out of the window first and
+				 *reports the next deadline then (see resend_wake)*/
+				if (ack_pending (txwin, ad->rACK)) {
+					stats->nr_resend_stale++;
+					cond_signal (&(ad->inter->waketx), 1, 1);
+				} else if (ad->tx_busy) {
+					/*TX writes frames it registered just now, they are not resent before*/
+					if (now + P::TO_RES < deadline)
+						deadline = now + P::TO_RES;
+				} else {
+					if (now >= ad->rs_next) {
+						/*Resend the oldest frame after a timeout, further expired frames follow RETX_BURST at a time
+						 *every RETX_GAP (TX stops the burst once the remote got frames beyond them)*/
+						if ((ret = resend_frame (txwin, resend, ad->rs_burst ? P::RETX_BURST : 1, stats->RTT, now)) > 0) {
+							if (!ad->rs_burst) {
+								ad->rs_burst = 1;
+								ad->rs_start = now;
+								ad->rs_sent = 0;
+								ad->rs_low = txwin->low_seq;
+								ad->rs_high = txwin->low_seq;
+								stats->nr_resend_bursts++;
+							}
+							ad->rs_sent += ret;
+							for (a = 0; a < (__u32)ret; a++) {
+								i = sctpreq_get_seq (resend[a].req);
+								if (((i - ad->rs_low) & txwin->mask) > ((ad->rs_high - ad->rs_low) & txwin->mask))
+									ad->rs_high = i;
+							}
+							/*They are written after unlocking, TX must not give them back meanwhile*/
+							ad->rs_busy = 1;
+#ifdef WITH_PACING
+							/*Resends are never delayed, new frames of TX wait for them*/
+							pace_fill (ad);
+#endif
+#ifdef WITH_PACING
+							for (a = 0; a < (__u32)ret; a++)
+								ad->pace_tokens -= pace_cost (ad, sctpreq_get_size (resend[a].req));
+#endif
+							/*A requested ACK goes with them (set when they are written)*/
+							ackreq = ad->REQ;
+							ad->REQ = 0;
+						}
+						if (ret == -1)
+							//resend timeout
+							do_hard_exit<P>(ExitCode::MAX_RESENDS);
+						/*Frames still expired wait for the next slot, the burst ends with the last of them*/
+						if (ad->rs_burst) {
+							if (resend_deadline (txwin, stats->RTT) <= now)
+								ad->rs_next = now + P::RETX_GAP;
+							else
+								resend_burst_end (ad);
+						}
+					}
+					/*Next frame due (none in flight: TX wakes us for the first one), not before the next slot*/
+					next = resend_deadline (txwin, stats->RTT);
+					if (next < ad->rs_next)
+						next = ad->rs_next;
+					if (next < deadline)
+						deadline = next;
+				}
+			}
+			ad->rs_wake = deadline;
+			wlock_unlock (ad);
 		}
 
-		/*Check if we can operate normally*/
-		if (likely(ad->STATUS.empty[0] == STAT_NORMAL)) {
-			if (spin_try_lock (wlock)) {
-				/*Try to resend oldest frames*/
-				if ((ret = resend_frame (txwin, resend, stats->RTT, ad->currtime)) > 0)
-				{
-					a = 0;
-					while (a < (__u32)ret) {
-						packet = resend[a].req;
-
-						size = sctpreq_get_size(packet);
-
-						/* Send old packet and merge it with ACK published from RX recently*/
-						sctpreq_set_ack (packet, ad->ACK);
-						ad->REQ = 0;
-						b = sock_write (sock, packet, size);
-						assert(b % 4 == 0); // assert on alignment
-						if (b<0) {
-							SCTRL_LOG_ERROR("Could not resend frame (write to socket failed for NAME: %s)", get_admin<P>()->NAME);
-							pthread_exit(NULL);
-						}
+		if (ret > 0) {
+			/* Send old packets in bursts, in turns with TX*/
+			b = 0;
+			acked = false;
+			pthread_mutex_lock (&(ad->slock));
+#ifdef WITH_ZEROCOPY
+			zc_next = sock->zc_next;
+#endif
+			a = 0;
+			while ((a < (__u32)ret) && (b >= 0)) {
+				nburst = 0;
+				while ((nburst < P::TX_BURST) && (a < (__u32)ret)) {
+					packet = resend[a].req;
+					/*Merge them with ACK published from RX recently*/
+					if (ack_refresh (ad, packet))
+						acked = true;
+					burst[nburst] = packet;
+					burst_size[nburst] = sctpreq_get_size(packet);
+					nburst++;
+					a++;
+				}
+				b = sock_write_batch (sock, burst, burst_size, nburst);
+				if (b<0)
+					break;
+
+				/*Updating statistics*/
+				for (i = 0; i < nburst; i++) {
+					stats->bytes_sent_resend += burst_size[i];
+					stats->bytes_sent += burst_size[i];
+				}
+				stats->nr_resent_timeout += nburst;
+			}
+#ifdef WITH_ZEROCOPY
+			zc_last = sock->zc_next;
+#endif
+			pthread_mutex_unlock (&(ad->slock));
+			if (b<0) {
+				SCTRL_LOG_ERROR("Could not resend frame (write to socket failed for NAME: %s)", get_admin<P>()->NAME);
+				pthread_exit(NULL);
+			}
+			/*No frame could take the ACK (zerocopy sends pending), TX sends it*/
+			if (ackreq) {
+				if (acked)
+					stats->nr_ack_piggybacked++;
+				else
+					ack_request (ad);
+			}
 
-						/*Updating statistics*/
-						stats->bytes_sent_resend += size;
-						stats->bytes_sent += size;
-						a++;
-					}
+			wlock_lock (ad);
+#ifdef WITH_ZEROCOPY
+			/*Frame may be acked before the resent copy completed*/
+			if (zc_last != zc_next) {
+				for (a = 0; a < (__u32)ret; a += nburst) {
+					for (nburst = 0; (nburst < P::TX_BURST) && ((a + nburst) < (__u32)ret); nburst++)
+						burst[nburst] = resend[a + nburst].req;
+					mark_zerocopy (txwin, burst, nburst, zc_last - 1);
 				}
-				if (ret == -1)
-					//resend timeout
-					do_hard_exit<P>(ExitCode::MAX_RESENDS);
-				spin_unlock (wlock);
 			}
+#endif
+			ad->rs_busy = 0;
+			/*TX left a new remote ACK alone meanwhile*/
+			if (ack_pending (txwin, ad->rACK))
+				cond_signal (&(ad->inter->waketx), 1, 1);
+			wlock_unlock (ad);
 		}
-		/*Lets sleep again*/
+
+		/*Only we arm the timer, TX and RX wake us by rs_event (a zero timeout disarms)*/
+		if (deadline != TIME_NONE) {
+			deadline = (deadline > now) ? (deadline - now) * 1000 : 1;
+			its.it_value.tv_sec = deadline / 1000000000ULL;
+			its.it_value.tv_nsec = deadline % 1000000000ULL;
+		} else {
+			its.it_value.tv_sec = 0;
+			its.it_value.tv_nsec = 0;
+		}
+		if (timerfd_settime (ad->rs_timer, 0, &its, NULL) < 0)
+			SCTRL_LOG_ERROR("Could not arm resend timer (NAME: %s)", get_admin<P>()->NAME);
 	}
-#ifdef WITH_HPET
-	timer_close (&(ad->txtimer));
-#endif
+	close (ad->rs_event);
+	close (ad->rs_timer);
 	pthread_exit(NULL);
 }
 
@@ -1077,6 +1805,10 @@ __s8 SCTP_CoreUp(
 	struct sctp_alloc<P> *txbuf_ptr = NULL;
 	struct sctp_alloc<P> *rxbuf_ptr = NULL;
 	__u32 remote_ip;
+#ifdef WITH_CONGAV
+	char const *cc_name;
+	__s32 cc_algo;
+#endif
 
 #define TX_BUFSPQ (P::TX_BUFSIZE)
 #define RX_BUFSPQ (P::RX_BUFSIZE/P::MAX_NUM_QUEUES)
@@ -1136,6 +1868,15 @@ __s8 SCTP_CoreUp(
 	cond_init (&(get_admin<P>()->inter->waketx));
 	get_admin<P>()->inter->waketx.semval = 0;
 
+	/*TX and RESEND write the socket in turns*/
+	pthread_mutex_init (&(get_admin<P>()->slock), NULL);
+	get_admin<P>()->rs_busy = 0;
+	get_admin<P>()->tx_busy = 0;
+	get_admin<P>()->rACK_gen = 0;
+	get_admin<P>()->rs_next = 0;
+	get_admin<P>()->rs_sent = 0;
+	get_admin<P>()->rs_burst = 0;
+
 	/*First initialising windows*/
 	ret = win_init(&(get_admin<P>()->txwin), P::MAX_NRFRAMES, P::MAX_WINSIZ, SCTP_TXWIN);
 	if (ret < 0) {
@@ -1147,6 +1888,30 @@ __s8 SCTP_CoreUp(
 		deallocate(2);
 		return -5;
 	}
+#ifdef WITH_CONGAV
+	/*Congestion controller of TX, aimd unless the environment names another one*/
+	if ((cc_name = getenv (CC_ENV)) && *cc_name) {
+		if ((cc_algo = cc_find (cc_name)) < 0) {
+			SCTRL_LOG_ERROR ("Unknown congestion control %s=%s", CC_ENV, cc_name);
+			deallocate(3);
+			return -5;
+		}
+		cc_init (&(get_admin<P>()->txwin.cc), cc_algo, P::MAX_WINSIZ);
+	}
+#endif
+#ifdef WITH_PACING
+	/*Token bucket of TX, starts full*/
+	get_admin<P>()->pace_rate = P::PACE_RATE;
+	get_admin<P>()->pace_burst = P::PACE_BURST;
+	/*A rate of 0 turns pacing off, a burst must hold a full frame*/
+	if ((pace_env (PACE_RATE_ENV, 0, PACE_RATE_MAX, &(get_admin<P>()->pace_rate)) < 0) ||
+	    (pace_env (PACE_BURST_ENV, MTU + WIRE_OVERHEAD, PACE_BURST_MAX, &(get_admin<P>()->pace_burst)) < 0)) {
+		deallocate(3);
+		return -5;
+	}
+	get_admin<P>()->pace_tokens = (__s64)(get_admin<P>()->pace_burst * 1000);
+	get_admin<P>()->pace_time = spin_clock ();
+#endif
 
 	/*Initializing fifos*/
 #ifdef WITH_ROUTING
@@ -1196,12 +1961,18 @@ __s8 SCTP_CoreUp(
 
 	SCTRL_LOG_INFO ("> sub structures successfully initialized");
 
-	/*End of allocation, next we have to open the socket*/
-	c = sock_init(&(get_admin<P>()->sock), &remote_ip, data_port, reset_port, data_local_port);
+	/*End of allocation, next we have to open the socket (or the memory link given as "shm:<name>")*/
+	if (strncmp (rip, SHM_ADDR_PREFIX, strlen(SHM_ADDR_PREFIX)) == 0)
+		c = shm_init(&(get_admin<P>()->sock), rip + strlen(SHM_ADDR_PREFIX), sizeof(arq_frame<P>));
+	else
+		c = sock_init(&(get_admin<P>()->sock), &remote_ip, data_port, reset_port, data_local_port);
 	if (c != 0) {
 		deallocate(8);
 		return -4;
 	}
+	get_admin<P>()->sock.stats = &(get_admin<P>()->inter->stats);
+	sock_register_pool(&(get_admin<P>()->sock), get_admin<P>()->inter->pool, sizeof(get_admin<P>()->inter->pool));
+	sock_busy_poll(&(get_admin<P>()->sock), P::BUSY_POLL_RX);
 
 	SCTRL_LOG_INFO ("> socket opened and bound to device");
 
@@ -1223,6 +1994,21 @@ __s8 SCTP_CoreUp(
 
 	(void) pthread_join (get_admin<P>()->allocthr, NULL);
 
+	/* RX and TX wake RESEND through his timer and event, so both exist before any thread starts (timer disarmed until the first frame is sent) */
+	get_admin<P>()->rs_timer = timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (get_admin<P>()->rs_timer < 0) {
+		SCTRL_LOG_ERROR ("Could not create resend timer (NAME: %s)", get_admin<P>()->NAME);
+		deallocate(10);
+		return -4;
+	}
+	get_admin<P>()->rs_event = eventfd (0, EFD_CLOEXEC);
+	if (get_admin<P>()->rs_event < 0) {
+		SCTRL_LOG_ERROR ("Could not create resend event (NAME: %s)", get_admin<P>()->NAME);
+		deallocate(10);
+		return -4;
+	}
+	get_admin<P>()->rs_wake = TIME_NONE;
+
 	c = pthread_create (&get_admin<P>()->rxthr, NULL, SCTP_RX<P>, get_admin<P>());
 	if (c != 0) {
 		deallocate(11);
@@ -1234,25 +2020,19 @@ __s8 SCTP_CoreUp(
 		return -4;
 	}
 
-#ifdef WITH_HPET
-	/* Before we start RESEND, we need to set up his timer */
-	c = timer_init (&(get_admin<P>()->txtimer), "/dev/hpet", 1000000/P::TO_RES);
-	if (c < 0) {
-		deallocate(13);
-		return -4;
-	} else {
-		printf ("RESEND timer started @ %dHz\n", 1000000/P::TO_RES);
-	}
-#endif
-
 #ifdef WITH_CONGAV
-	SCTRL_LOG_INFO ("Congestion avoidance active");
+	SCTRL_LOG_INFO ("Congestion avoidance active (%s)", sctp_cc_algos[get_admin<P>()->txwin.cc.algo].name);
 #endif
 
 #ifdef WITH_RTTADJ
 	SCTRL_LOG_INFO ("RTO adjust active");
 #endif
 
+#ifdef WITH_PACING
+	if (get_admin<P>()->pace_rate)
+		SCTRL_LOG_INFO ("Pacing active (%llu bytes/us, bursts of %llu bytes)", get_admin<P>()->pace_rate, get_admin<P>()->pace_burst);
+#endif
+
 	c = pthread_create (&get_admin<P>()->rsthr, NULL, SCTP_RESEND<P>, get_admin<P>());
 	if (c != 0) {
 		deallocate(12);
@@ -1289,7 +2069,7 @@ __s8 SCTP_CoreUp(
 		return -4;
 	}
 
-	SCTRL_LOG_INFO ("SCTP CORE OPEN SUCCESSFUL (max pdu words: %lu, window size: %lu, DELAY_ACK: %lu)", P::MAX_PDUWORDS, P::MAX_WINSIZ, P::DELAY_ACK);
+	SCTRL_LOG_INFO ("SCTP CORE OPEN SUCCESSFUL (max pdu words: %lu, window size: %lu, DELAY_ACK: %lu, ACK_EVERY: %lu)", P::MAX_PDUWORDS, P::MAX_WINSIZ, P::DELAY_ACK, P::ACK_EVERY);
 
 	/*TODO: Update mem counter in stats*/
 
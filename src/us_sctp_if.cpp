@@ -71,6 +71,31 @@ static arq_frame<P> *fetch_frames (sctp_fifo *fifo, sctp_alloc<P> *local_buf, vo
 	}
 }
 
+/*Blocking pop from an rx queue (WITH_BUSY_POLL: spins up to P::BUSY_POLL_USER us before sleeping)*/
+template<typename P>
+static void rx_pop (sctp_descr<P> *desc, sctp_fifo *fifo, sctp_alloc<P> *cache) {
+#ifdef WITH_BUSY_POLL
+	if (P::BUSY_POLL_USER > 0) {
+		__u64 start = spin_clock ();
+		__u64 now = start;
+		__s8 ret = SC_EMPTY;
+		while (1) {
+			if ((fifo->nr_full.semval > 0) && ((ret = try_fif_pop (fifo, (__u8 *)cache, desc->trans)) == 0))
+				break;
+			now = spin_clock ();
+			if ((now - start) >= P::BUSY_POLL_USER * 1000ULL)
+				break;
+			cpu_relax ();
+		}
+		/*several clients share the stats*/
+		__atomic_fetch_add (&(desc->trans->stats.ns_spin_user), now - start, __ATOMIC_RELAXED);
+		if (ret == 0)
+			return;
+	}
+#endif
+	fif_pop (fifo, (__u8 *)cache, desc->trans);
+}
+
 template<typename P>
 static void push_frames (sctp_fifo *fifo, sctp_alloc<P> *local_buf, void *baseptr, arq_frame<P> *ptr, __u8 flush) {
 	__u32 i;
@@ -264,6 +289,7 @@ __s32 acq_buf (sctp_descr<P> *desc, buf_desc<P> *acq, const __u8 mode)
 #if (__GNUC__ >= 9)
 #pragma GCC diagnostic pop
 #endif
+	acq->tstamp = 0;
 
 	return 1;
 }
@@ -523,7 +549,7 @@ __s32 recv_buf (sctp_descr<P> *desc, buf_desc<P> *buf, const __u8 mode)
 				return ret;
 			}
 		} else
-			fif_pop(&(desc->trans->rx_queues[0]), (__u8*) &(desc->recv_buf.in[0]), desc->trans);
+			rx_pop<P>(desc, &(desc->trans->rx_queues[0]), &(desc->recv_buf.in[0]));
 
 		for (i = 0; i < desc->recv_buf.in[0].num; i++) {
 			desc->recv_buf.in[0].fptr[i] =
@@ -547,6 +573,11 @@ __s32 recv_buf (sctp_descr<P> *desc, buf_desc<P> *buf, const __u8 mode)
 	buf->payload = buf->arq_sctrl->COMMANDS;
 #if (__GNUC__ >= 9)
 #pragma GCC diagnostic pop
+#endif
+#ifdef WITH_TIMESTAMPING
+	buf->tstamp = desc->trans->tstamp[ptr_to_frame - desc->trans->pool];
+#else
+	buf->tstamp = 0;
 #endif
 
 	return 1;
@@ -600,7 +631,7 @@ __s32 recv_buf(sctp_descr<P>* desc, buf_desc<P>* buf, const __u8 mode, __u64 idx
 				if (mode & MODE_SAFE) mutex_unlock (&(desc->mutex));
 				return ret;
 			}
-		} else fif_pop (&(desc->trans->rx_queues[queue]), (__u8 *)&(desc->recv_buf.in[queue]), desc->trans);
+		} else rx_pop<P> (desc, &(desc->trans->rx_queues[queue]), &(desc->recv_buf.in[queue]));
 
 		for (i = 0; i < desc->recv_buf.in[queue].num; i++) {
 			desc->recv_buf.in[queue].fptr[i] = static_cast<arq_frame<P>*>(get_abs_ptr (desc->trans, desc->recv_buf.in[queue].fptr[i]));
@@ -622,6 +653,11 @@ __s32 recv_buf(sctp_descr<P>* desc, buf_desc<P>* buf, const __u8 mode, __u64 idx
 	buf->payload = buf->arq_sctrl->COMMANDS;
 #if (__GNUC__ >= 9)
 #pragma GCC diagnostic pop
+#endif
+#ifdef WITH_TIMESTAMPING
+	buf->tstamp = desc->trans->tstamp[ptr_to_frame - desc->trans->pool];
+#else
+	buf->tstamp = 0;
 #endif
 
 	return 1;
@@ -0,0 +1,211 @@
+/* Memory ring transport backend (see us_sctp_shm.h)
+ * */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sctrltp/us_sctp_shm.h"
+#include "sctrltp/us_sctp_sock.h"
+#include "sctrltp/logger.h"
+
+namespace sctrltp {
+
+/* waits until *ptr differs from val: spins first, then sleeps on the futex with *waiting set */
+static void shm_wait (__vs32 *ptr, __vs32 *waiting, __s32 val)
+{
+	__u32 i;
+
+	for (i = 0; i < SHM_SPIN; i++) {
+		if (*ptr != val)
+			return;
+		cpu_relax ();
+	}
+	/* full barrier, the other side reads waiting after updating ptr */
+	xchg (waiting, 1);
+	if (*ptr == val)
+		futex_wait (ptr, val);
+	*waiting = 0;
+}
+
+/* publishes val in *ptr and wakes the other side if it sleeps on it; returns 1 if it had to be woken */
+static __u8 shm_publish (__vs32 *ptr, __vs32 *waiting, __s32 val)
+{
+	/* full barrier: the slots are written (read) before, waiting is read after */
+	xchg (ptr, val);
+	if (*waiting) {
+		futex_wake (ptr, 1);
+		return 1;
+	}
+	return 0;
+}
+
+static __s32 shm_read_batch (struct sctp_sock *ssock, void **bufs, __s32 *nread, __u32 num, __u32 buflen)
+{
+	struct shm_ring *ring = ssock->shm.rx;
+	struct shm_slot *slot;
+	__u32 slot_size = ssock->shm.link->slot_size;
+	__s32 head, tail = ring->tail;
+	__u32 i, len;
+
+	/* block for the first frame only, then take whatever is there already */
+	while ((head = ring->head) == tail)
+		shm_wait (&ring->head, &ring->rx_wait, tail);
+	/* the slots up to head are written */
+	loadfence ();
+	for (i = 0; (i < num) && (tail != head); i++, tail++) {
+		slot = (struct shm_slot *) (ssock->shm.rx_slots + (size_t)((__u32) tail % SHM_NR_SLOTS) * slot_size);
+		len = (slot->len > buflen) ? buflen : slot->len;
+		memcpy (bufs[i], slot + 1, len);
+		nread[i] = (len == 0) ? SC_INVAL : (__s32) len;
+#ifdef WITH_TIMESTAMPING
+		ssock->rx_tstamp[i] = 0;
+#endif
+	}
+	shm_publish (&ring->tail, &ring->tx_wait, tail);
+	return i;
+}
+
+static __s32 shm_write_batch (struct sctp_sock *ssock, void *const *bufs, __u32 const *len, __u32 num)
+{
+	struct shm_ring *ring = ssock->shm.tx;
+	struct shm_slot *slot;
+	__u32 slot_size = ssock->shm.link->slot_size;
+	__s32 head = ring->head, tail;
+	__u32 i = 0;
+	__u64 start;
+
+	while (i < num) {
+		/* wait for the other endpoint to free slots (counted like a full socket buffer) */
+		if ((__u32)(head - (tail = ring->tail)) >= SHM_NR_SLOTS) {
+			start = spin_clock ();
+			while ((__u32)(head - (tail = ring->tail)) >= SHM_NR_SLOTS)
+				shm_wait (&ring->tail, &ring->tx_wait, tail);
+			if (ssock->stats) {
+				ssock->stats->nr_tx_blocked++;
+				ssock->stats->ns_tx_blocked += spin_clock () - start;
+			}
+		}
+		for (; (i < num) && ((__u32)(head - tail) < SHM_NR_SLOTS); i++, head++) {
+			if (len[i] > slot_size - sizeof(struct shm_slot)) {
+				errno = EMSGSIZE;
+				return SC_ABORT;
+			}
+			slot = (struct shm_slot *) (ssock->shm.tx_slots + (size_t)((__u32) head % SHM_NR_SLOTS) * slot_size);
+			slot->len = len[i];
+			memcpy (slot + 1, bufs[i], len[i]);
+		}
+		if (shm_publish (&ring->head, &ring->rx_wait, head) && ssock->stats)
+			ssock->stats->nr_tx_syscalls++;
+	}
+	if (ssock->stats)
+		ssock->stats->nr_sent += num;
+	return num;
+}
+
+/* there is no reset port, reset frames travel with the data */
+static __s32 shm_write_reset (struct sctp_sock *ssock, void const *buf, __u32 len)
+{
+	void *bufs[1] = { (void *) buf };
+
+	if (shm_write_batch (ssock, bufs, &len, 1) < 0)
+		return SC_ABORT;
+	return len;
+}
+
+struct sock_transport const shm_transport = {
+	"shm",
+	shm_read_batch,
+	shm_write_batch,
+	shm_write_reset
+};
+
+__s8 shm_init (struct sctp_sock *ssock, char const *name, __u32 frame_size)
+{
+	struct shm_link *link;
+	struct stat st;
+	__u32 slot_size, waited;
+	size_t len;
+	__s32 fd;
+	__u8 creator;
+
+	memset (ssock, 0, sizeof(struct sctp_sock));
+	ssock->sd = -1;
+#ifdef WITH_BPF
+	ssock->filter_map = -1;
+#endif
+
+	/* slots keep frames 8 byte aligned */
+	slot_size = (sizeof(struct shm_slot) + frame_size + 7) & ~7U;
+	len = sizeof(struct shm_link) + 2 * (size_t) SHM_NR_SLOTS * slot_size;
+
+	fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	creator = (fd >= 0);
+	if (!creator && (errno == EEXIST))
+		fd = shm_open (name, O_RDWR, 0);
+	if (fd < 0) {
+		SCTRL_LOG_ERROR ("Could not open memory link %s: %s", name, strerror(errno));
+		return SC_ABORT;
+	}
+
+	if (creator) {
+		if (ftruncate (fd, len) < 0) {
+			SCTRL_LOG_ERROR ("Could not size memory link %s: %s", name, strerror(errno));
+			close (fd);
+			shm_unlink (name);
+			return SC_ABORT;
+		}
+	} else {
+		/* the creator may not have sized it yet */
+		for (waited = 0; (fstat (fd, &st) == 0) && (st.st_size == 0) && (waited < SHM_ATTACH_TIMEOUT); waited += 1000)
+			usleep (1000);
+		if ((fstat (fd, &st) != 0) || ((size_t) st.st_size != len)) {
+			SCTRL_LOG_ERROR ("Memory link %s has %lld bytes, expected %zu (frame size differs?)", name,
+			                 (long long) st.st_size, len);
+			close (fd);
+			return SC_ABORT;
+		}
+	}
+
+	link = (struct shm_link *) mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close (fd);
+	if (link == MAP_FAILED) {
+		SCTRL_LOG_ERROR ("Could not map memory link %s: %s", name, strerror(errno));
+		if (creator)
+			shm_unlink (name);
+		return SC_ABORT;
+	}
+
+	if (creator) {
+		link->slot_size = slot_size;
+		link->nr_slots = SHM_NR_SLOTS;
+		xchg (&link->ready, 1);
+	} else {
+		for (waited = 0; !link->ready && (waited < SHM_ATTACH_TIMEOUT); waited += 1000)
+			usleep (1000);
+		if (!link->ready || (link->slot_size != slot_size) || (link->nr_slots != SHM_NR_SLOTS)) {
+			SCTRL_LOG_ERROR ("Memory link %s not set up or set up differently", name);
+			munmap (link, len);
+			return SC_ABORT;
+		}
+		/* both endpoints are attached, the name is not needed anymore */
+		shm_unlink (name);
+	}
+
+	ssock->shm.link = link;
+	ssock->shm.map_len = len;
+	ssock->shm.tx = &link->ring[creator ? 0 : 1];
+	ssock->shm.rx = &link->ring[creator ? 1 : 0];
+	ssock->shm.tx_slots = (__u8 *)(link + 1) + (creator ? 0 : (size_t) SHM_NR_SLOTS * slot_size);
+	ssock->shm.rx_slots = (__u8 *)(link + 1) + (creator ? (size_t) SHM_NR_SLOTS * slot_size : 0);
+	ssock->tp = &shm_transport;
+
+	SCTRL_LOG_INFO ("Attached to memory link %s (%s, %u slots of %u bytes)", name,
+	                creator ? "created" : "second endpoint", SHM_NR_SLOTS, slot_size);
+	return 0;
+}
+
+} // namespace sctrltp
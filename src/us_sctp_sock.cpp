@@ -6,11 +6,112 @@
 #include <sys/time.h>
 
 #include "sctrltp/us_sctp_sock.h"
+#ifdef WITH_BPF
+#include "sctrltp/us_sctp_bpf.h"
+#endif
 #include "sctrltp/us_sctp_core.h"
 #include "sctrltp/logger.h"
 
 namespace sctrltp {
 
+#ifdef WITH_TIMESTAMPING
+/* kernel timestamp (see SOCK_TS_HW) in the control data of msg, 0 if there is none */
+static __u64 sock_cmsg_tstamp (struct msghdr *msg)
+{
+	struct cmsghdr *cm;
+	struct scm_timestamping *tss;
+
+	for (cm = CMSG_FIRSTHDR(msg); cm != NULL; cm = CMSG_NXTHDR(msg, cm)) {
+		if ((cm->cmsg_level != SOL_SOCKET) || (cm->cmsg_type != SCM_TIMESTAMPING))
+			continue;
+		tss = (struct scm_timestamping *) CMSG_DATA(cm);
+		/* ts[2]: raw hardware timestamp (if the NIC does stamping), ts[0]: software */
+		if (tss->ts[2].tv_sec || tss->ts[2].tv_nsec)
+			return (tss->ts[2].tv_sec * 1000000000ULL + tss->ts[2].tv_nsec) | SOCK_TS_HW;
+		return tss->ts[0].tv_sec * 1000000000ULL + tss->ts[0].tv_nsec;
+	}
+	return 0;
+}
+
+/* remembers the frames of the next send, their timestamp comes back with its key */
+static void sock_ts_sent (struct sctp_sock *ssock, struct iovec const *iov, size_t iovlen)
+{
+	__u32 key;
+	size_t j;
+
+	if (!ssock->ts)
+		return;
+	key = ssock->ts_next++ % SOCK_TS_TRACK;
+	ssock->ts_first[key] = ssock->ts_fpos;
+	ssock->ts_nframes[key] = 0;
+	for (j = 0; j < iovlen; j++) {
+		/* ACK frames do not have a sequence number */
+		if (iov[j].iov_len <= sizeof(struct arq_ackframe))
+			continue;
+		ssock->ts_frame[ssock->ts_fpos++ % SOCK_TS_TRACK] = iov[j].iov_base;
+		ssock->ts_nframes[key]++;
+	}
+}
+
+/* queues the frames of send key with their timestamp for sock_tx_tstamps (oldest are dropped) */
+static void sock_ts_complete (struct sctp_sock *ssock, __u32 key, __u64 ts)
+{
+	__u32 i, first, slot;
+
+	/* too old, its frames are not tracked anymore */
+	if ((ssock->ts_next - key - 1) >= SOCK_TS_TRACK)
+		return;
+	first = ssock->ts_first[key % SOCK_TS_TRACK];
+	if ((ssock->ts_fpos - first) > SOCK_TS_TRACK)
+		return;
+	for (i = 0; i < ssock->ts_nframes[key % SOCK_TS_TRACK]; i++) {
+		if (ssock->ts_done_num == SOCK_TS_TRACK) {
+			ssock->ts_done_head = (ssock->ts_done_head + 1) % SOCK_TS_TRACK;
+			ssock->ts_done_num--;
+		}
+		slot = (ssock->ts_done_head + ssock->ts_done_num) % SOCK_TS_TRACK;
+		ssock->ts_done_frame[slot] = ssock->ts_frame[(first + i) % SOCK_TS_TRACK];
+		ssock->ts_done[slot] = ts;
+		ssock->ts_done_num++;
+	}
+}
+#endif
+
+#if !defined(WITH_PACKET_MMAP) && !defined(WITH_IO_URING)
+/* control data of a received datagram: drop counter (and timestamps) */
+#ifdef WITH_TIMESTAMPING
+#define SOCK_RX_CTRL (CMSG_SPACE(sizeof(__u32)) + CMSG_SPACE(3 * sizeof(struct timespec)))
+#else
+#define SOCK_RX_CTRL CMSG_SPACE(sizeof(__u32))
+#endif
+
+/* accounts the datagrams the kernel dropped on the socket before msg was queued (SO_RXQ_OVFL,
+ * the cmsg carries the socket's cumulative drop counter once it is nonzero) */
+static void sock_cmsg_drops (struct sctp_sock *ssock, struct msghdr *msg)
+{
+	struct cmsghdr *cm;
+	__u32 drops;
+
+	for (cm = CMSG_FIRSTHDR(msg); cm != NULL; cm = CMSG_NXTHDR(msg, cm)) {
+		if ((cm->cmsg_level != SOL_SOCKET) || (cm->cmsg_type != SO_RXQ_OVFL))
+			continue;
+		memcpy (&drops, CMSG_DATA(cm), sizeof(drops));
+		if ((__s32)(drops - ssock->rx_drops) > 0) {
+			if (ssock->stats)
+				ssock->stats->nr_sockdrop += drops - ssock->rx_drops;
+			ssock->rx_drops = drops;
+		}
+	}
+}
+#endif
+
+/* waits for the full socket buffer to take data again (see below) */
+static void sock_wait_tx (struct sctp_sock *ssock);
+
+#ifdef WITH_IO_URING
+static_assert(SOCK_MAX_BATCH <= URING_TX_ENTRIES, "io_uring transmit ring too small for a socket batch");
+#endif
+
 // variable gets updates when the socket is opened
 static double sock_init_time = 0.0;
 
@@ -21,6 +122,343 @@ double mytime() {
 }
 
 
+#ifdef WITH_PACKET_MMAP
+/* finds the index of the interface carrying the local address of the connected socket sd */
+static __s32 sock_ifindex (__s32 sd)
+{
+	struct sockaddr_in local;
+	socklen_t len = sizeof(local);
+	struct ifaddrs *ifa, *i;
+	__s32 ifindex = 0;
+
+	if (getsockname (sd, (struct sockaddr *)&local, &len) < 0)
+		return 0;
+	if (getifaddrs (&ifa) < 0)
+		return 0;
+	for (i = ifa; i != NULL; i = i->ifa_next) {
+		if (i->ifa_addr && (i->ifa_addr->sa_family == AF_INET) &&
+		    (((struct sockaddr_in *)i->ifa_addr)->sin_addr.s_addr == local.sin_addr.s_addr)) {
+			ifindex = if_nametoindex (i->ifa_name);
+			break;
+		}
+	}
+	freeifaddrs (ifa);
+	return ifindex;
+}
+
+/* sets up the TPACKET_V3 rx ring on a packet socket bound to the interface of the (connected)
+ * data socket; only the FPGA's UDP flow is let into the ring, the data socket itself gets nothing */
+static __s8 sock_ring_init (struct sctp_sock *ssock)
+{
+	struct sockaddr_in local;
+	struct sockaddr_ll ll;
+	socklen_t len = sizeof(local);
+	struct sock_fprog fprog;
+	int retval;
+	/* cooked packet socket: offset 0 is the IP header */
+	struct sock_filter prog[] = {
+		/* IPv4 without options, UDP, not fragmented */
+		BPF_STMT(BPF_LD+BPF_B+BPF_ABS, 0),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0x45, 0, 11),
+		BPF_STMT(BPF_LD+BPF_B+BPF_ABS, 9),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, IPPROTO_UDP, 0, 9),
+		BPF_STMT(BPF_LD+BPF_H+BPF_ABS, 6),
+		BPF_JUMP(BPF_JMP+BPF_JSET+BPF_K, 0x3fff, 7, 0),
+		/* from REMOTE_IP:UDP_DATA_PORT to our local port */
+		BPF_STMT(BPF_LD+BPF_W+BPF_ABS, 12),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0, 0, 5),
+		BPF_STMT(BPF_LD+BPF_H+BPF_ABS, 20),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0, 0, 3),
+		BPF_STMT(BPF_LD+BPF_H+BPF_ABS, 22),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0, 0, 1),
+		/* accept packet by returning -1 */
+		BPF_STMT(BPF_RET+BPF_K, (__u32) -1),
+		/* ignore/drop packet by returning 0 */
+		BPF_STMT(BPF_RET+BPF_K, 0),
+	};
+	struct sock_filter drop[] = {
+		BPF_STMT(BPF_RET+BPF_K, 0),
+	};
+
+	if (getsockname (ssock->sd, (struct sockaddr *)&local, &len) < 0) {
+		perror ("getsockname failed");
+		return SC_ABORT;
+	}
+	prog[7].k = ntohl(ssock->remote_ip);
+	prog[9].k = ssock->udp_port_data;
+	prog[11].k = ntohs(local.sin_port);
+
+	ssock->ring_sd = socket (AF_PACKET, SOCK_DGRAM, htons(ETH_P_IP));
+	if (ssock->ring_sd < 0) {
+		perror ("packet socket creation failed");
+		return SC_ABORT;
+	}
+
+	/* filter before binding, so no foreign packet makes it into the ring */
+	fprog.len = sizeof(prog) / sizeof(struct sock_filter);
+	fprog.filter = prog;
+	if (setsockopt (ssock->ring_sd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) != 0) {
+		perror ("bpf filter prog attach");
+		return SC_ABORT;
+	}
+	/* our own frames on loopback */
+	retval = 1;
+	setsockopt (ssock->ring_sd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &retval, sizeof(retval));
+
+	retval = TPACKET_V3;
+	if (setsockopt (ssock->ring_sd, SOL_PACKET, PACKET_VERSION, &retval, sizeof(retval)) != 0) {
+		perror ("TPACKET_V3 not supported");
+		return SC_ABORT;
+	}
+	memset (&ssock->req, 0, sizeof(ssock->req));
+	ssock->req.tp_block_size = TP_BLOCK_SIZE;
+	ssock->req.tp_block_nr = TP_BLOCK_NR;
+	ssock->req.tp_frame_size = TP_FRAME_SIZE;
+	ssock->req.tp_frame_nr = TP_BLOCK_SIZE / TP_FRAME_SIZE * TP_BLOCK_NR;
+	ssock->req.tp_retire_blk_tov = TP_RETIRE_TOV;
+	if (setsockopt (ssock->ring_sd, SOL_PACKET, PACKET_RX_RING, &ssock->req, sizeof(ssock->req)) != 0) {
+		perror ("rx ring setup failed");
+		return SC_ABORT;
+	}
+	ssock->ring_ptr = (__u8 *) mmap (0, TP_BLOCK_SIZE * TP_BLOCK_NR, PROT_READ | PROT_WRITE,
+	                                 MAP_SHARED | MAP_LOCKED, ssock->ring_sd, 0);
+	if (ssock->ring_ptr == MAP_FAILED) {
+		perror ("Couldn't map RX_RING kernel memory into userspace");
+		return SC_ABORT;
+	}
+
+	memset (&ll, 0, sizeof(ll));
+	ll.sll_family = AF_PACKET;
+	ll.sll_protocol = htons(ETH_P_IP);
+	ll.sll_ifindex = sock_ifindex (ssock->sd);
+	if ((ll.sll_ifindex == 0) || (bind (ssock->ring_sd, (struct sockaddr *)&ll, sizeof(ll)) < 0)) {
+		perror ("binding packet socket to interface failed");
+		return SC_ABORT;
+	}
+
+	/* the data socket would get a copy of every frame otherwise */
+	fprog.len = 1;
+	fprog.filter = drop;
+	if (setsockopt (ssock->sd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) != 0) {
+		perror ("bpf filter prog attach");
+		return SC_ABORT;
+	}
+
+	ssock->ring_idx = 0;
+	ssock->ring_left = 0;
+	ssock->pfd.fd = ssock->ring_sd;
+	ssock->pfd.events = POLLIN | POLLERR;
+	SCTRL_LOG_INFO ("Set up %u bytes TPACKET_V3 rx ring (%u blocks) on interface %d",
+	                TP_BLOCK_SIZE * TP_BLOCK_NR, TP_BLOCK_NR, ll.sll_ifindex);
+	return 0;
+}
+
+/* copies up to num frames (UDP payload, at most buflen bytes) out of the rx ring, blocking only if
+ * the ring is empty; whole blocks are handed back to the kernel once read
+ * returns number of frames (nread[i] is SC_INVAL for empty datagrams), SC_ABORT on error */
+static __s32 sock_ring_read (struct sctp_sock *ssock, void **bufs, __s32 *nread, __u32 num, __u32 buflen)
+{
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *hdr;
+	struct tpacket_stats_v3 st;
+	socklen_t sts;
+	__u8 *ip;
+	__s32 len, retval;
+	__u32 got = 0;
+
+	while (got < num) {
+		bd = (struct tpacket_block_desc *)(ssock->ring_ptr + ssock->ring_idx * TP_BLOCK_SIZE);
+
+		if (ssock->ring_left == 0) {
+			if (!(__atomic_load_n (&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+				if (got > 0)
+					break;
+				/* we don't want to burn cpu cycles => poll for next block indefinitely */
+				do {
+					retval = poll (&ssock->pfd, 1, -1);
+				} while ((retval < 0) && (errno == EINTR));
+				if (retval < 0) {
+					SCTRL_LOG_ERROR("Failed to poll rx ring: %s\n", strerror(errno));
+					return SC_ABORT;
+				}
+				continue;
+			}
+			/* the kernel marks blocks filled while it had to drop packets */
+			if ((bd->hdr.bh1.block_status & TP_STATUS_LOSING) && ssock->stats) {
+				sts = sizeof(st);
+				if (getsockopt (ssock->ring_sd, SOL_PACKET, PACKET_STATISTICS, &st, &sts) == 0)
+					ssock->stats->nr_ringdrop += st.tp_drops;
+			}
+			ssock->ring_left = bd->hdr.bh1.num_pkts;
+			ssock->ring_pkt = (__u8 *) bd + bd->hdr.bh1.offset_to_first_pkt;
+		}
+
+		if (ssock->ring_left > 0) {
+			hdr = (struct tpacket3_hdr *) ssock->ring_pkt;
+			ip = ssock->ring_pkt + hdr->tp_net;
+
+			/* the filter let only IPv4 without options in, the UDP length tells us about padding */
+			len = ntohs(*(__u16 *)(ip + 20 + 4)) - 8;
+			if (len > (__s32) hdr->tp_snaplen - 28)
+				len = hdr->tp_snaplen - 28;
+			if (len > (__s32) buflen)
+				len = buflen;
+			if (len > 0) {
+				memcpy (bufs[got], ip + 28, len);
+				nread[got] = len;
+			} else {
+				nread[got] = SC_INVAL;
+			}
+#ifdef WITH_TIMESTAMPING
+			ssock->rx_tstamp[got] = (hdr->tp_sec * 1000000000ULL + hdr->tp_nsec) |
+			                        ((hdr->tp_status & TP_STATUS_TS_RAW_HARDWARE) ? SOCK_TS_HW : 0);
+#endif
+			got++;
+
+			ssock->ring_pkt += hdr->tp_next_offset;
+			ssock->ring_left--;
+		}
+
+		if (ssock->ring_left == 0) {
+			/* release block */
+			__atomic_store_n (&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+			ssock->ring_idx = (ssock->ring_idx + 1) % TP_BLOCK_NR;
+		}
+	}
+	return got;
+}
+#endif
+
+
+#ifdef WITH_BPF
+/* attaches the socket filter to the data socket (data starts at the UDP header); ACK frames
+ * (MIN_PACKET_SIZE) pass, everything else needs a complete header and a matching LEN field */
+static __s8 sock_filter_init (struct sctp_sock *ssock)
+{
+	/* with receive offload, only the first of the coalesced frames can be checked */
+	bool gro = false;
+	/* offset of the jump targets relative to the instruction following instruction pc */
+	#define ACCEPT(pc) ((__s16)(13 - ((pc) + 1)))
+	#define DROP(pc)   ((__s16)(15 - ((pc) + 1)))
+	struct bpf_insn prog[] = {
+		insn (BPF_ALU64 | BPF_MOV | BPF_X, 6, 1, 0, 0),                /*  0: r6 = skb (ld_abs) */
+		insn (BPF_LDX | BPF_MEM | BPF_W, 7, 6, 0, 0),                   /*  1: r7 = skb->len */
+		insn (BPF_ALU64 | BPF_SUB | BPF_K, 7, 0, 0, 8),                /*  2: r7 -= UDP header */
+		insn (BPF_JMP | BPF_JEQ | BPF_K, 7, 0, ACCEPT(3), MIN_PACKET_SIZE),
+		insn (BPF_ALU64 | BPF_MOV | BPF_K, 8, 0, 0, SOCK_FLT_SHORT),   /*  4 */
+		insn (BPF_JMP | BPF_JLT | BPF_K, 7, 0, DROP(5), ARQ_HEADER_SIZE + TYPLEN_SIZE),
+		insn (BPF_LD | BPF_ABS | BPF_H, 0, 0, 0, 8 + ARQ_HEADER_SIZE + 2), /* 6: r0 = LEN */
+		insn (BPF_ALU64 | BPF_LSH | BPF_K, 0, 0, 0, 3),                /*  7: words to bytes */
+		insn (BPF_ALU64 | BPF_ADD | BPF_K, 0, 0, 0, ARQ_HEADER_SIZE + TYPLEN_SIZE),
+		insn (BPF_ALU64 | BPF_MOV | BPF_K, 8, 0, 0, SOCK_FLT_LEN),     /*  9 */
+		insn (BPF_JMP | BPF_JGT | BPF_X, 0, 7, DROP(10), 0),           /* 10: frame exceeds datagram */
+		insn (BPF_JMP | BPF_JNE | BPF_X, 0, 7, DROP(11), 0),           /* 11: (nop with GRO) */
+		insn (BPF_JMP | BPF_JA, 0, 0, ACCEPT(12), 0),
+		insn (BPF_ALU64 | BPF_MOV | BPF_K, 0, 0, 0, -1),               /* 13: accept */
+		insn (BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+		insn (BPF_STX | BPF_MEM | BPF_W, 10, 8, -4, 0),                /* 15: drop, key = r8 */
+		insn (BPF_ALU64 | BPF_MOV | BPF_X, 2, 10, 0, 0),
+		insn (BPF_ALU64 | BPF_ADD | BPF_K, 2, 0, 0, -4),
+		insn (BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, 0),  /* 18: r1 = counter map */
+		insn (0, 0, 0, 0, 0),
+		insn (BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem),
+		insn (BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2, 0),
+		insn (BPF_ALU64 | BPF_MOV | BPF_K, 1, 0, 0, 1),
+		insn (BPF_STX | BPF_XADD | BPF_DW, 0, 1, 0, 0),                /* 23: counter++ */
+		insn (BPF_ALU64 | BPF_MOV | BPF_K, 0, 0, 0, 0),
+		insn (BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+	};
+	#undef ACCEPT
+	#undef DROP
+	/* the same checks in classic BPF (offset 0 is the UDP header) */
+	struct sock_filter cprog[] = {
+		BPF_STMT(BPF_LD+BPF_W+BPF_LEN, 0),
+		BPF_STMT(BPF_ALU+BPF_SUB+BPF_K, 8),
+		BPF_STMT(BPF_MISC+BPF_TAX, 0),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, MIN_PACKET_SIZE, 8, 0),
+		BPF_JUMP(BPF_JMP+BPF_JGE+BPF_K, ARQ_HEADER_SIZE + TYPLEN_SIZE, 0, 8),
+		BPF_STMT(BPF_LD+BPF_H+BPF_ABS, 8 + ARQ_HEADER_SIZE + 2),
+		BPF_STMT(BPF_ALU+BPF_LSH+BPF_K, 3),
+		BPF_STMT(BPF_ALU+BPF_ADD+BPF_K, ARQ_HEADER_SIZE + TYPLEN_SIZE),
+		BPF_JUMP(BPF_JMP+BPF_JGT+BPF_X, 0, 4, 0),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_X, 0, 1, 0),
+		BPF_STMT(BPF_JMP+BPF_JA, 2),                /* LEN < datagram: ok with GRO only */
+		/* accept packet by returning -1 */
+		BPF_STMT(BPF_RET+BPF_K, (__u32) -1),
+		BPF_STMT(BPF_RET+BPF_K, (__u32) -1),
+		/* ignore/drop packet by returning 0 */
+		BPF_STMT(BPF_RET+BPF_K, 0),
+	};
+	union bpf_attr attr;
+	struct sock_fprog fprog;
+	__s32 fd;
+
+#ifdef WITH_UDP_GRO
+	gro = ssock->gro;
+#endif
+	if (gro) {
+		prog[11] = insn (BPF_JMP | BPF_JA, 0, 0, 0, 0);
+		cprog[10].k = 0;
+	}
+
+	memset (&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_ARRAY;
+	attr.key_size = sizeof(__u32);
+	attr.value_size = sizeof(__u64);
+	attr.max_entries = SOCK_FLT_NR;
+	ssock->filter_map = sys_bpf (BPF_MAP_CREATE, &attr);
+	fd = -1;
+	if (ssock->filter_map >= 0) {
+		prog[18].imm = ssock->filter_map;
+		memset (&attr, 0, sizeof(attr));
+		attr.prog_type = BPF_PROG_TYPE_SOCKET_FILTER;
+		attr.insns = (__u64)(unsigned long) prog;
+		attr.insn_cnt = sizeof(prog) / sizeof(struct bpf_insn);
+		attr.license = (__u64)(unsigned long) "LGPL";
+		fd = sys_bpf (BPF_PROG_LOAD, &attr);
+	}
+	if ((fd >= 0) && (setsockopt (ssock->sd, SOL_SOCKET, SO_ATTACH_BPF, &fd, sizeof(fd)) == 0)) {
+		/* the socket holds a reference to the program */
+		close (fd);
+		return 0;
+	}
+
+	SCTRL_LOG_WARN ("eBPF socket filter not permitted (%s), filter drops are not counted", strerror(errno));
+	if (fd >= 0)
+		close (fd);
+	if (ssock->filter_map >= 0)
+		close (ssock->filter_map);
+	ssock->filter_map = -1;
+	fprog.len = sizeof(cprog) / sizeof(struct sock_filter);
+	fprog.filter = cprog;
+	if (setsockopt (ssock->sd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) != 0) {
+		perror ("bpf filter prog attach");
+		return SC_ABORT;
+	}
+	return 0;
+}
+
+void sock_filter_stats (struct sctp_sock *ssock)
+{
+	union bpf_attr attr;
+	__u32 key;
+	__u64 val[SOCK_FLT_NR];
+
+	if ((ssock->filter_map < 0) || (ssock->stats == NULL))
+		return;
+	memset (val, 0, sizeof(val));
+	for (key = 0; key < SOCK_FLT_NR; key++) {
+		memset (&attr, 0, sizeof(attr));
+		attr.map_fd = ssock->filter_map;
+		attr.key = (__u64)(unsigned long) &key;
+		attr.value = (__u64)(unsigned long) &val[key];
+		sys_bpf (BPF_MAP_LOOKUP_ELEM, &attr);
+	}
+	ssock->stats->nr_fltdrop_short = val[SOCK_FLT_SHORT];
+	ssock->stats->nr_fltdrop_len = val[SOCK_FLT_LEN];
+}
+#endif
+
 __s8 sock_init(
     struct sctp_sock* ssock,
     const __u32* remote_ip,
@@ -32,44 +470,6 @@ __s8 sock_init(
 	struct in_addr rip; // ECM: remote ip TODO: add to arguments
 	int retval, sock_buf_size;
 	(void)retval; // ECM(2017-12-07): We use retval in some code paths...
-#ifdef WITH_PACKET_MMAP
-	unsigned int i, j;
-#endif
-#ifdef WITH_BPF
-	struct bpf_program filter;
-	struct bpf_insn prog[] = {
-		/*Check on protocol number*/
-		BPF_STMT(BPF_LD+BPF_H+BPF_ABS, 12),
-		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0, 0, 11),
-		/*Check on my MAC*/
-		BPF_STMT(BPF_LD+BPF_W+BPF_ABS, 0),
-		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0, 0, 9),
-		BPF_STMT(BPF_LD+BPF_H+BPF_ABS, 4),
-		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0, 0, 7),
-		/*Check on remote MAC*/
-		BPF_STMT(BPF_LD+BPF_W+BPF_ABS, 6),
-		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0, 0, 5),
-		BPF_STMT(BPF_LD+BPF_H+BPF_ABS, 10),
-		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, 0, 0, 3),
-		/*Check on arq protocol type*/
-		BPF_STMT(BPF_LD+BPF_B+BPF_ABS, 15),
-		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, SCTP_TYP_DEFAULT, 0, 1),
-		/*accept packet by returning -1*/
-		BPF_STMT(BPF_RET+BPF_K, -1),
-		/*ignore/drop packet by returning 0*/
-		BPF_STMT(BPF_RET+BPF_K, 0),
-	};
-	/*Register instructions in program structure*/
-	filter.bf_insns = prog;
-	/*Insert arguments to set up filter properly*/
-	prog[1].k = proto;
-	prog[3].k = ((__u32)txmac[0]<<24)+((__u32)txmac[1]<<16)+((__u32)txmac[2]<<8)+txmac[3];
-	prog[5].k = ((__u16)txmac[4]<<8)+txmac[5];
-	prog[7].k = ((__u32)rxmac[0]<<24)+((__u32)rxmac[1]<<16)+((__u32)rxmac[2]<<8)+rxmac[3];
-	prog[9].k = ((__u16)rxmac[4]<<8)+rxmac[5];
-	/*Calculate number of instructions in prog*/
-	filter.bf_len = sizeof(prog) / sizeof(struct bpf_insn);
-#endif
 
 	memset (&rip, 0, sizeof(struct in_addr));
 	memset (ssock, 0, sizeof(struct sctp_sock));
@@ -90,15 +490,6 @@ __s8 sock_init(
 
 	memcpy(&(ssock->remote_ip), remote_ip, sizeof(__u32)); // remote address
 
-#ifdef WITH_BPF
-#error FIX BPF before compiling with BPF
-	/*Create Berkeley Packet Filter program and attach it to socket*/
-	if (setsockopt(ssock->sd, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) != 0) {
-		perror ("bpf filter prog attach");
-		return SC_ABORT;
-	}
-#endif
-
 	/* setup data socket: bind to some local port on 0.0.0.0 */
 	memset(&opts, 0, sizeof(opts));
 	opts.sin_family = AF_INET;
@@ -122,53 +513,79 @@ __s8 sock_init(
 	ssock->udp_port_data = data_port;
 	ssock->udp_port_reset = reset_port;
 
-#ifdef WITH_PACKET_MMAP
-	/* buffer indices init */
-	ssock->ring_idx = 0;
-
-	/* poll structure init */
-	ssock->pfd.fd      = ssock->sd;
-	ssock->pfd.revents = 0;
-	ssock->pfd.events  = POLLIN|POLLERR;
+#if !defined(WITH_PACKET_MMAP) && !defined(WITH_IO_URING)
+	/* have every read report the drops on the socket (Linux >= 2.6.33) */
+	retval = 1;
+	if (setsockopt (ssock->sd, SOL_SOCKET, SO_RXQ_OVFL, &retval, sizeof(retval)) != 0)
+		SCTRL_LOG_WARN ("SO_RXQ_OVFL not supported, kernel drops are not counted");
+#endif
 
-	/* get block size limit: getpagesize() << MAX_ORDER */
-	/* maximum get_free_pages is assumed to be 4096 << 11 == 8 MB (2.6/i386 default) */
-	ssock->req.tp_block_size = TP_BLOCK_SIZE;
-	ssock->req.tp_frame_size = TP_FRAME_SIZE;
-	ssock->req.tp_block_nr   = TP_BLOCK_NR;
-	ssock->req.tp_frame_nr   = TP_FRAME_NR;
-	printf ("PAGE_SIZE is %ld. MAX_ORDER is %d\n", PAGE_SIZE, MAX_ORDER);
-	printf ("rx ring: %d %d %d %d\n", TP_BLOCK_SIZE, TP_FRAME_SIZE, TP_BLOCK_NR, TP_FRAME_NR);
-	retval = setsockopt (ssock->sd, SOL_PACKET, PACKET_RX_RING, (void *) &(ssock->req), sizeof(ssock->req));
-	if (retval) {
-		perror("Hmm, some problem with rx ring setup");
+#ifdef WITH_PACKET_MMAP
+	if (sock_ring_init (ssock) < 0)
 		return SC_ABORT;
-	}
+#endif
 
-	/* memory map kernel rx ring buffer into our userspace */
-	printf ("Allocating %d bytes of RX Ring memory\n", TP_BLOCK_SIZE * TP_BLOCK_NR);
-	ssock->ring_ptr = (void *) mmap (0, TP_BLOCK_SIZE * TP_BLOCK_NR, PROT_READ | PROT_WRITE, MAP_SHARED, ssock->sd, 0);
-	/* TODO: If 64-bit cleanness issues arise, check for TPACKET_V2 stuff */
-	if (ssock->ring_ptr == MAP_FAILED) {
-		perror("Couldn't map RX_RING kernel memory into userspace");
+#ifdef WITH_IO_URING
+	if (uring_init (&ssock->uring, ssock->sd) < 0)
 		return SC_ABORT;
-	}
+#endif
 
-	printf ("PACKET_RX_RING activated.\n");
+#ifdef WITH_AF_XDP
+	/* without XSK (no privileges, loopback, ...) frames take the UDP socket */
+	if (xdp_init (&ssock->xdp, ssock->sd) < 0)
+		SCTRL_LOG_WARN ("AF_XDP not usable, falling back to the UDP socket");
+#endif
 
-	printf ("%p\n", ssock->ring_ptr);
-	ssock->ring = (void *) malloc( sizeof(void *) * ssock->req.tp_frame_nr);
-	for (i = ssock->ring_cnt = 0; i < ssock->req.tp_block_nr; i++)
-		for (j = 0; j < ssock->req.tp_block_size / ssock->req.tp_frame_size; j++) {
-			ssock->ring[ssock->ring_cnt] = (__u8 *) ssock->ring_ptr + i * ssock->req.tp_block_size + j * ssock->req.tp_frame_size;
-			printf ("%d %d: %p\n", i, j, ssock->ring[ssock->ring_cnt]);
-			ssock->ring_cnt++;
+#ifdef WITH_UDP_GRO
+	/* receive coalesced datagrams (Linux >= 5.0), otherwise we read one datagram per frame */
+	retval = 1;
+	ssock->gro = (setsockopt (ssock->sd, SOL_UDP, UDP_GRO, &retval, sizeof(retval)) == 0);
+	if (ssock->gro) {
+		ssock->gro_buf = (__u8 *) malloc (SOCK_GRO_BUFSIZE);
+		if (ssock->gro_buf == NULL) {
+			perror ("allocating GRO staging area failed");
+			return SC_ABORT;
 		}
+	} else {
+		SCTRL_LOG_WARN ("UDP_GRO not supported, receiving without receive offload");
+	}
+#endif
+
+#ifdef WITH_BPF
+	/* after GRO setup: coalesced datagrams need a relaxed length check */
+	if (sock_filter_init (ssock) < 0)
+		return SC_ABORT;
+#endif
 
-	printf ("Set up %u bytes ring buffer (%u packets)\n", ssock->req.tp_block_size * ssock->req.tp_block_nr, ssock->ring_cnt);
+#ifdef WITH_TIMESTAMPING
+	/* stamp datagrams on arrival and when they leave (TX stamps are keyed by the number of the send) */
+	retval = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE |
+	         SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_HARDWARE |
+	         SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+	         SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+	ssock->ts = (setsockopt (ssock->sd, SOL_SOCKET, SO_TIMESTAMPING, &retval, sizeof(retval)) == 0);
+	if (!ssock->ts)
+		SCTRL_LOG_WARN ("SO_TIMESTAMPING not supported, frames are not timestamped");
+#ifdef WITH_PACKET_MMAP
+	retval = SOF_TIMESTAMPING_RAW_HARDWARE;
+	setsockopt (ssock->ring_sd, SOL_PACKET, PACKET_TIMESTAMP, &retval, sizeof(retval));
+#endif
+#endif
 
-	/* debugging rx ring */
-	debug = ssock;
+#ifdef WITH_ZEROCOPY
+	/* Linux >= 4.14 (UDP: 5.0), otherwise every frame is copied into the kernel */
+	retval = 1;
+	ssock->zc = (setsockopt (ssock->sd, SOL_SOCKET, SO_ZEROCOPY, &retval, sizeof(retval)) == 0);
+	if (!ssock->zc)
+		SCTRL_LOG_WARN ("SO_ZEROCOPY not supported, sending with copies");
+#endif
+
+#ifdef WITH_UDP_GSO
+	/* probe for segmentation offload (Linux >= 4.18), otherwise we send one datagram per frame */
+	retval = 0;
+	ssock->gso = (setsockopt (ssock->sd, SOL_UDP, UDP_SEGMENT, &retval, sizeof(retval)) == 0);
+	if (!ssock->gso)
+		SCTRL_LOG_WARN ("UDP_SEGMENT not supported, sending without segmentation offload");
 #endif
 
 #ifdef DEBUG
@@ -183,80 +600,150 @@ __s8 sock_init(
 }
 
 
-/*returns number of bytes stored into buf (should be HEADER+NB*SCTRLCMD bytes)*/
-template <typename arq_frame>
-__s32 sock_read (struct sctp_sock *ssock, arq_frame *buf, __u8 filter)
+void sock_register_pool (struct sctp_sock *ssock, void *base, size_t len)
 {
-
-	__s32 nread = 0;
-	__u8 *tmp;
-#ifdef WITH_PACKET_MMAP
-	struct tpacket_hdr *hdr; /* pointer to a packet header */
-	int retval, loop;
+#ifdef WITH_IO_URING
+	if (ssock->tp)
+		return;
+	uring_register_pool (&ssock->uring, base, len);
+#else
+	(void) ssock;
+	(void) base;
+	(void) len;
 #endif
-	tmp = (__u8 *)buf;
-
-	(void) filter; /* TODO: unused parameter */
+}
 
+void sock_busy_poll (struct sctp_sock *ssock, __u32 us)
+{
+#ifdef WITH_BUSY_POLL
+	int val = us;
+
+	/* other transports do not go through the kernel */
+	if (ssock->tp)
+		return;
+	ssock->busy_poll_us = us;
+	/* raising it above net.core.busy_read needs CAP_NET_ADMIN, we spin in userspace anyway */
+	if (setsockopt (ssock->sd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)) != 0)
+		SCTRL_LOG_WARN ("SO_BUSY_POLL not permitted: %s", strerror(errno));
 #ifdef WITH_PACKET_MMAP
-	/* try to read packets || poll for packets */
-
+	setsockopt (ssock->ring_sd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val));
+#endif
+#ifdef WITH_AF_XDP
+	if (ssock->xdp.fd >= 0)
+		setsockopt (ssock->xdp.fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val));
+#endif
+#else
+	(void) ssock;
+	(void) us;
+#endif
+}
 
-check_rx_ring:
-	loop = 1;
-	while (loop == 1) { /* prepared to read multiple in a row... */
-		/* rx ring structure */
-		tmp = ssock->ring[ssock->ring_idx];
-		hdr = (struct tpacket_hdr *) tmp;
+#ifdef WITH_BUSY_POLL
+/* returns true if a read would not block */
+static bool sock_rx_ready (struct sctp_sock *ssock)
+{
+#if defined(WITH_PACKET_MMAP)
+	struct tpacket_block_desc *bd;
+
+	if (ssock->ring_left > 0)
+		return true;
+	bd = (struct tpacket_block_desc *)(ssock->ring_ptr + ssock->ring_idx * TP_BLOCK_SIZE);
+	return (__atomic_load_n (&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER);
+#elif defined(WITH_IO_URING)
+	return uring_rx_ready (&ssock->uring);
+#else
+#ifdef WITH_AF_XDP
+	if (ssock->xdp.fd >= 0)
+		return xdp_rx_ready (&ssock->xdp);
+#endif
+#ifdef WITH_UDP_GRO
+	if (ssock->gro && (ssock->gro_off < ssock->gro_len))
+		return true;
+#endif
+	/* non-blocking peek, the kernel busy polls the device queue for us (SO_BUSY_POLL) */
+	return (recv (ssock->sd, NULL, 0, MSG_PEEK | MSG_DONTWAIT | MSG_TRUNC) >= 0);
+#endif
+}
 
-		/* jump over packet processing => we assume that the kernel inserts at next position! */
-		if (! hdr->tp_status)
+/* spins until a read would not block or the budget is used up */
+static void sock_spin_rx (struct sctp_sock *ssock)
+{
+	__u64 start, now;
+
+	if (sock_rx_ready (ssock))
+		return;
+	start = now = spin_clock ();
+	while ((now - start) < ssock->busy_poll_us * 1000ULL) {
+		cpu_relax ();
+		if (sock_rx_ready (ssock))
 			break;
+		now = spin_clock ();
+	}
+	if (ssock->stats)
+		ssock->stats->ns_spin_rx += spin_clock () - start;
+}
+#endif
 
-		/* goto to next slot in ring */
-		if (++ssock->ring_idx >= ssock->ring_cnt)
-			ssock->ring_idx = 0;
-
-		/* we do not handle packets that are too big, dropped, other stuff */
-		if ((hdr->tp_status & TP_STATUS_COPY))         assert (0); /* return SC_ABORT; */
-		if ((hdr->tp_status & TP_STATUS_LOSING))       ssock->drops++;
-		if ((hdr->tp_status & TP_STATUS_CSUMNOTREADY)) assert (0); /* return SC_ABORT; */
-
-		/* process packet */
-		if (likely(hdr->tp_len == hdr->tp_snaplen)) {
-
-			/* let tmp point to real data: tp_mac + 14 should be tp_net */
-			nread = hdr->tp_snaplen;
-			tmp = tmp + hdr->tp_mac;
+template <typename arq_frame>
+__u32 sock_provide_rx (struct sctp_sock *ssock, arq_frame **bufs, __u32 num)
+{
+#ifdef WITH_IO_URING
+	if (ssock->tp)
+		return 0;
+	return uring_provide_rx (&ssock->uring, (void **) bufs, num, sizeof(arq_frame));
+#else
+	(void) ssock;
+	(void) bufs;
+	(void) num;
+	return 0;
+#endif
+}
 
-			/* TODO: for now, we copy for upper layers and release slot
-			 * => later: handle memory up and call /free-slot/ from upper layer */
-			memcpy (buf, tmp, nread);
+/*returns number of bytes stored into buf (should be HEADER+NB*SCTRLCMD bytes)*/
+template <typename arq_frame>
+__s32 sock_read (struct sctp_sock *ssock, arq_frame *buf, __u8 filter)
+{
 
-			/* received a frame - leave the loop (single frame read ;)) */
-			loop = 0;
-		} else { /* discard the packet */ ; }
+	__s32 nread = 0;
+	__u8 *tmp;
+	tmp = (__u8 *)buf;
 
-		/* release frame */
-		hdr->tp_status = TP_STATUS_KERNEL;
+	(void) filter; /* TODO: unused parameter */
 
-		printf("rx: f%2d - read %4d\n", ssock->ring_idx, nread);
+	if (ssock->tp) {
+		if (ssock->tp->read_batch (ssock, (void **) &tmp, &nread, 1, sizeof(arq_frame)) < 0)
+			return SC_ABORT;
+		return nread;
 	}
 
-	if (unlikely(! nread)) {
-		/* poll_for_packet */
-
-		/* we don't want to burn cpu cycles => poll for new packet indefinitetly */
-		do {
-			/* profiling interrupts system calls, so let's loop it */
-			retval = poll(&ssock->pfd, 1, -1);
-		} while (retval < 0 && errno == EINTR);
-
-		assert (retval >= 0); /* 0 == timeout, negative indicates error */
-		goto check_rx_ring;
+#ifdef WITH_PACKET_MMAP
+	if (sock_ring_read (ssock, (void **) &tmp, &nread, 1, sizeof(arq_frame)) < 0)
+		return SC_ABORT;
+	if (nread == SC_INVAL) {
+		SCTRL_LOG_ERROR("Read 0 bytes from socket!?\n");
+		return SC_ABORT;
 	}
 
+#elif defined(WITH_IO_URING)
+	/* single reads are copied, the caller expects the data in buf */
+	if (uring_recv (&ssock->uring, ssock->sd, (void **) &tmp, &nread, 1, 0) < 0)
+		return SC_ABORT;
+	if (nread == 0) {
+		SCTRL_LOG_ERROR("Read 0 bytes from socket!?\n");
+		return SC_ABORT;
+	}
 #else /* end of WITH_PACKET_MMAP */
+#ifdef WITH_AF_XDP
+	if (ssock->xdp.fd >= 0) {
+		if (xdp_recv (&ssock->xdp, (void **) &tmp, &nread, 1, sizeof(arq_frame)) < 0)
+			return SC_ABORT;
+		if (nread == 0) {
+			SCTRL_LOG_ERROR("Read 0 bytes from socket!?\n");
+			return SC_ABORT;
+		}
+		return nread;
+	}
+#endif
 	do {
 		nread = read (ssock->sd, tmp, sizeof(arq_frame));
 	} while ((nread < 0) && (errno == EINTR));
@@ -272,6 +759,171 @@ check_rx_ring:
 	return nread;
 }
 
+#ifdef WITH_UDP_GRO
+/* reads the next (possibly coalesced) datagram into the staging area, blocking only if wait is set
+ * returns number of bytes (SC_EMPTY if nothing is there and wait is not set), SC_ABORT on error*/
+static __s32 sock_read_gro (struct sctp_sock *ssock, __u8 wait)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cm;
+	__u8 ctrl[CMSG_SPACE(sizeof(int)) + SOCK_RX_CTRL];
+	__s32 ret;
+
+	while (1) {
+		memset (&msg, 0, sizeof(msg));
+		iov.iov_base = ssock->gro_buf;
+		iov.iov_len = SOCK_GRO_BUFSIZE;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = ctrl;
+		msg.msg_controllen = sizeof(ctrl);
+
+		do {
+			ret = recvmsg (ssock->sd, &msg, wait ? 0 : MSG_DONTWAIT);
+		} while ((ret < 0) && (errno == EINTR));
+		if (ret < 0) {
+			if (!wait && (errno == EAGAIN))
+				return SC_EMPTY;
+			SCTRL_LOG_ERROR("Failed to read from socket: %s\n", strerror(errno));
+			return SC_ABORT;
+		}
+		if (!(msg.msg_flags & MSG_TRUNC))
+			break;
+		/* coalesced beyond the staging area: its last segment would be cut, the datagram counts as dropped */
+		sock_cmsg_drops (ssock, &msg);
+		if (ssock->stats)
+			ssock->stats->nr_sockdrop++;
+	}
+
+	/* without cmsg the datagram was not coalesced */
+	ssock->gro_segsize = ret;
+	for (cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+		if ((cm->cmsg_level == SOL_UDP) && (cm->cmsg_type == UDP_GRO))
+			ssock->gro_segsize = *((int *) CMSG_DATA(cm));
+	}
+	ssock->gro_len = ret;
+	ssock->gro_off = 0;
+	sock_cmsg_drops (ssock, &msg);
+#ifdef WITH_TIMESTAMPING
+	ssock->gro_tstamp = sock_cmsg_tstamp (&msg);
+#endif
+	return ret;
+}
+#endif
+
+/*reads a burst of datagrams with one syscall (see header)*/
+template <typename arq_frame>
+__s32 sock_read_batch (struct sctp_sock *ssock, arq_frame **bufs, __s32 *nread, __u32 num)
+{
+	if (ssock->tp)
+		return ssock->tp->read_batch (ssock, (void **) bufs, nread, num, sizeof(arq_frame));
+#ifdef WITH_BUSY_POLL
+	if (ssock->busy_poll_us)
+		sock_spin_rx (ssock);
+#endif
+#if defined(WITH_IO_URING)
+	__s32 ret;
+	__s32 i;
+
+	ret = uring_recv (&ssock->uring, ssock->sd, (void **) bufs, nread, num, 1);
+	for (i = 0; i < ret; i++) {
+		if (nread[i] == 0)
+			nread[i] = SC_INVAL;
+	}
+	return ret;
+#elif defined(WITH_PACKET_MMAP)
+	return sock_ring_read (ssock, (void **) bufs, nread, num, sizeof(arq_frame));
+#else
+	struct mmsghdr msgs[SOCK_MAX_BATCH];
+	struct iovec iovs[SOCK_MAX_BATCH];
+	__u8 ctrl[SOCK_MAX_BATCH][SOCK_RX_CTRL];
+	__s32 ret;
+	__u32 i;
+
+	if (num > SOCK_MAX_BATCH)
+		num = SOCK_MAX_BATCH;
+
+#ifdef WITH_AF_XDP
+	if (ssock->xdp.fd >= 0) {
+		/* frames are copied out of the UMEM (headroom would overwrite the neighbouring pool frame) */
+		ret = xdp_recv (&ssock->xdp, (void **) bufs, nread, num, sizeof(arq_frame));
+		for (i = 0; i < (__u32) ret; i++) {
+			if (nread[i] == 0)
+				nread[i] = SC_INVAL;
+		}
+		return ret;
+	}
+#endif
+
+#ifdef WITH_UDP_GRO
+	if (ssock->gro) {
+		__u32 seg;
+
+		/* hand out segments of staged datagrams, read another one as long as it does not block */
+		i = 0;
+		while (i < num) {
+			if (ssock->gro_off >= ssock->gro_len) {
+				ret = sock_read_gro (ssock, (i == 0));
+				if (ret == SC_ABORT)
+					return SC_ABORT;
+				if (ret == SC_EMPTY)
+					break;
+				if (ret == 0) {
+					nread[i++] = SC_INVAL;
+					continue;
+				}
+			}
+			seg = ssock->gro_len - ssock->gro_off;
+			if (seg > ssock->gro_segsize)
+				seg = ssock->gro_segsize;
+			nread[i] = (seg > sizeof(arq_frame)) ? sizeof(arq_frame) : seg;
+			memcpy (bufs[i], ssock->gro_buf + ssock->gro_off, nread[i]);
+#ifdef WITH_TIMESTAMPING
+			ssock->rx_tstamp[i] = ssock->gro_tstamp;
+#endif
+			ssock->gro_off += seg;
+			i++;
+		}
+		return i;
+	}
+#endif
+
+	memset (msgs, 0, sizeof(struct mmsghdr) * num);
+	for (i = 0; i < num; i++) {
+		iovs[i].iov_base = bufs[i];
+		iovs[i].iov_len = sizeof(arq_frame);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = ctrl[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+	}
+
+	/* block for the first datagram only, then take whatever is queued already */
+	do {
+		ret = recvmmsg (ssock->sd, msgs, num, MSG_WAITFORONE, NULL);
+	} while ((ret < 0) && (errno == EINTR));
+	if (ret < 0) {
+		SCTRL_LOG_ERROR("Failed to read from socket: %s\n", strerror(errno));
+		return SC_ABORT;
+	} else if (ret == 0) {
+		SCTRL_LOG_ERROR("Read 0 datagrams from socket!?\n");
+		return SC_ABORT;
+	}
+
+	for (i = 0; i < (__u32) ret; i++) {
+		nread[i] = msgs[i].msg_len;
+		if (nread[i] == 0)
+			nread[i] = SC_INVAL;
+		sock_cmsg_drops (ssock, &msgs[i].msg_hdr);
+#ifdef WITH_TIMESTAMPING
+		ssock->rx_tstamp[i] = sock_cmsg_tstamp (&msgs[i].msg_hdr);
+#endif
+	}
+	return ret;
+#endif
+}
+
 template <typename P>
 void print_stats () {
 	struct sctp_core<P> *ad = SCTP_debugcore<P>();
@@ -291,6 +943,20 @@ void print_stats () {
 		printf ("%15lld payload packets received                    %5.1f%%\n", ad->inter->stats.nr_received_payload, ftmp);
 		ftmp = 100.0*ad->inter->stats.nr_protofault/ad->inter->stats.nr_received;
 		printf ("%15lld non SCTP packets dropped                    %5.1f%%\n", ad->inter->stats.nr_protofault, ftmp);
+#ifdef WITH_BPF
+		sock_filter_stats (&ad->sock);
+		printf ("%15lld packets dropped by socket filter (short)\n", ad->inter->stats.nr_fltdrop_short);
+		printf ("%15lld packets dropped by socket filter (bad LEN)\n", ad->inter->stats.nr_fltdrop_len);
+#endif
+		/*sk_drops includes what the (eBPF) socket filter dropped*/
+		i = ad->inter->stats.nr_sockdrop;
+#ifdef WITH_BPF
+		if (i > ad->inter->stats.nr_fltdrop_short + ad->inter->stats.nr_fltdrop_len)
+			i -= ad->inter->stats.nr_fltdrop_short + ad->inter->stats.nr_fltdrop_len;
+		else
+			i = 0;
+#endif
+		printf ("%15lld packets dropped by the kernel (socket queue full)\n", (long long) i);
 		ftmp = 100.0*ad->inter->stats.nr_congdrop/ad->inter->stats.nr_received;
 		printf ("%15lld packets lost (buffer full)                  %5.1f%%\n", ad->inter->stats.nr_congdrop, ftmp);
 		ftmp = 100.0*ad->inter->stats.nr_outofwin/ad->inter->stats.nr_received;
@@ -303,6 +969,10 @@ void print_stats () {
 		printf ("%15lld total payload bytes sent\n", ad->inter->stats.bytes_sent_payload);
 		ftmp = 100.0*ad->inter->stats.bytes_sent_resend/ad->inter->stats.bytes_sent;
 		printf ("%15lld total bytes resent                          %5.1f%%\n", ad->inter->stats.bytes_sent_resend, ftmp);
+		printf ("%15lld frames resent after timeout, %lld after duplicate ACKs (fast retransmit)\n",
+		        ad->inter->stats.nr_resent_timeout, ad->inter->stats.nr_resent_fast);
+		printf ("%15lld retransmit bursts (%lld frames left as remote got frames beyond, %lld resent spuriously)\n",
+		        ad->inter->stats.nr_resend_bursts, ad->inter->stats.nr_resend_stopped, ad->inter->stats.nr_resent_spurious);
 		printf ("%15lld total bytes sent\n", ad->inter->stats.bytes_sent);
 		printf ("%15lld total bytes acked\n", ad->inter->stats.bytes_sent-ad->inter->stats.bytes_sent_resend);
 		dtmp = mytime();
@@ -314,7 +984,51 @@ void print_stats () {
 		printf ("%15.3f MB/s payload RX rate (since last update)\n", ftmp);
 		ftmp = 1.0e-6 * ad->inter->stats.bytes_recv_payload / (dtmp - sock_init_time);
 		printf ("%15.3f MB/s payload RX rate (since start up)\n", ftmp);
-		printf ("%15lld estimated RTT [us]\n", ad->inter->stats.RTT);
+		printf ("%15lld retransmission timeout [us]\n", ad->inter->stats.RTT);
+#ifdef WITH_RTTADJ
+		printf ("%15lld smoothed RTT [us] (variation %lld us, timeout backed off %lld times)\n", ad->inter->stats.srtt,
+		        ad->inter->stats.rttvar, ad->inter->stats.nr_rto_backoff);
+#endif
+		ftmp = ad->inter->stats.nr_rx_batches ? 1.0*ad->inter->stats.nr_received/ad->inter->stats.nr_rx_batches : 0.0;
+		printf ("%15.1f average RX batch size (%lld socket reads)\n", ftmp, ad->inter->stats.nr_rx_batches);
+		ftmp = ad->inter->stats.nr_sent ? 1.0*ad->inter->stats.nr_tx_syscalls/ad->inter->stats.nr_sent : 0.0;
+		printf ("%15.3f TX syscalls per frame (%lld frames sent)\n", ftmp, ad->inter->stats.nr_sent);
+		printf ("%15lld ACK frames sent, %lld ACKs carried by data frames (%lld requested after frames out of sequence, %lld after %lu us)\n",
+		        ad->inter->stats.nr_ack_sent, ad->inter->stats.nr_ack_piggybacked, ad->inter->stats.nr_ack_ooo,
+		        ad->inter->stats.nr_ack_delayed, P::DELAY_ACK);
+		printf ("%15lld RESEND wakeups (%lld left frames to TX, which had not taken the remote ACK yet)\n",
+		        ad->inter->stats.nr_resend_wakeups, ad->inter->stats.nr_resend_stale);
+		printf ("%15lld times socket buffer full on send (%.3f ms waited)\n", ad->inter->stats.nr_tx_blocked,
+		        1e-6 * ad->inter->stats.ns_tx_blocked);
+#ifdef WITH_SACK
+		printf ("%15lld SACK frames sent, %lld frames acknowledged selectively by remote (SACK %s)\n",
+		        ad->inter->stats.nr_sack_sent, ad->inter->stats.nr_sacked, ad->SACK ? "on" : "off");
+#endif
+#ifdef WITH_ZEROCOPY
+		ftmp = ad->inter->stats.nr_zc_completions ? 1e-3*ad->inter->stats.ns_zc_latency/ad->inter->stats.nr_zc_completions : 0.0;
+		printf ("%15lld bytes sent without copy (%lld zerocopy sends, %lld copied anyway, %.1f us to completion)\n",
+		        ad->inter->stats.bytes_zc_saved, ad->inter->stats.nr_zc_completions, ad->inter->stats.nr_zc_copied, ftmp);
+#endif
+#ifdef WITH_PACING
+		ftmp = ad->inter->stats.nr_paced ? 1e-3*ad->inter->stats.ns_paced/ad->inter->stats.nr_paced : 0.0;
+		printf ("%15lld times TX waited for the token bucket (%.3f ms, %.1f us each; %lld bytes/us, bursts of %lld bytes)\n",
+		        ad->inter->stats.nr_paced, 1e-6 * ad->inter->stats.ns_paced, ftmp, ad->pace_rate, ad->pace_burst);
+#endif
+#ifdef WITH_LOCKSTATS
+		printf ("%15.3f ms TX window lock held (longest %.3f us), times held below 256 ns, 512 ns, 1, 2, 4, 8, 16, 32, 64 us, longer:\n",
+		        1e-6 * ad->inter->stats.ns_wlock_held, 1e-3 * ad->inter->stats.ns_wlock_max);
+		printf ("               ");
+		for (i = 0; i < LOCK_HIST; i++)
+			printf (" %lld", ad->inter->stats.nr_wlock_held[i]);
+		printf ("\n");
+#endif
+#ifdef WITH_BUSY_POLL
+		printf ("%15.3f ms spun by RX / %.3f ms by TX / %.3f ms by users\n", 1e-6 * ad->inter->stats.ns_spin_rx,
+		        1e-6 * ad->inter->stats.ns_spin_tx, 1e-6 * ad->inter->stats.ns_spin_user);
+#endif
+#ifdef WITH_PACKET_MMAP
+		printf ("%15lld packets dropped (rx ring full)\n", ad->inter->stats.nr_ringdrop);
+#endif
 		printf ("************************\n");
 
 		last_bytes_sent_payload = ad->inter->stats.bytes_sent_payload;
@@ -340,16 +1054,16 @@ void print_stats () {
 		if (tmp < 0) tmp = 0;
 		printf ("freerx: %.3d%%(%d) ",tmp*100/ad->inter->allocrx.nr_elem, tmp);
 		printf ("lock_mask: %.8x ", ad->inter->lock_mask);
-		printf ("RTT: %.lld [us] ", ad->inter->stats.RTT);
+		printf ("RTO: %.lld [us] ", ad->inter->stats.RTT);
 		printf ("CTS: %.lld [us] ", ad->currtime);
 
 		tmp = ad->txwin.high_seq - ad->txwin.low_seq;
 		if (((ad->txwin.low_seq + P::MAX_WINSIZ) < P::MAX_NRFRAMES) && (ad->txwin.high_seq > P::MAX_NRFRAMES))
 			tmp =  ad->txwin.high_seq + P::MAX_NRFRAMES - ad->txwin.low_seq;
 		printf ("TX: %05d-%05d (%4d, ", ad->txwin.low_seq, ad->txwin.high_seq, tmp);
-		tmp = 100*ad->txwin.cur_wsize/ad->txwin.max_wsize/sizeof(arq_frame<P>);
-		printf ("cws %3d%%, ", tmp);
-		tmp = 100*ad->txwin.ss_thresh/ad->txwin.max_wsize/sizeof(arq_frame<P>);
+		tmp = 100*ad->txwin.cc.cwnd/ad->txwin.max_wsize;
+		printf ("%s cws %3d%%, ", sctp_cc_algos[ad->txwin.cc.algo].name, tmp);
+		tmp = 100*ad->txwin.cc.ssthresh/ad->txwin.max_wsize;
 		printf ("sst %3d%%) ", tmp);
 
 		tmp = ad->rxwin.high_seq - ad->rxwin.low_seq;
@@ -363,30 +1077,6 @@ void print_stats () {
 		printf ("\n");
 	}
 
-#ifdef WITH_PACKET_MMAP
-	struct tpacket_hdr *hdr; /* pointer to a packet header */
-	__u8 *tmp;
-	struct tpacket_stats st;
-	socklen_t sts;
-	int i, sum = 0;
-
-	printf("looking at f%d (racy ;))\n", debug->ring_idx);
-	for (i = 0; i < debug->ring_cnt; ++i) {
-		tmp = debug->ring[i];
-		hdr = (struct tpacket_hdr *) tmp;
-
-		if (hdr->tp_status) {
-			printf("f%d (%lu), ", debug->ring_idx, hdr->tp_status);
-			sum++;
-		}
-	}
-	printf("\n");
-	sts = sizeof(st);
-	if (!getsockopt(debug->sd, SOL_PACKET, PACKET_STATISTICS, (char *) &st, &sts))
-		printf("recieved %u packets, dropped %u\n", st.tp_packets, st.tp_drops);
-
-	printf("%d packets in ring (%d were dropped.)\n", sum, debug->drops);
-#endif
 }
 
 template <typename arq_frame>
@@ -402,25 +1092,399 @@ __s32 sock_write (struct sctp_sock *ssock,  arq_frame *buf, __u32 len)
 	/* TODO: use PACKET_TX_RING (2.6.31)
 	 *       - implement sendfile/splice in sending code => zero-copy sending */
 
-	do {
-		nwritten = write (ssock->sd, buf, len);
+	if (ssock->tp) {
+		void *tbufs[1] = { buf };
+		if (ssock->tp->write_batch (ssock, tbufs, &len, 1) < 0)
+			return SC_ABORT;
+		return len;
+	}
+
+#ifdef WITH_IO_URING
+	void *bufs[1] = { buf };
+	if (uring_send (&ssock->uring, ssock->sd, bufs, &len, 1, ssock->stats) < 0)
+		return SC_ABORT;
+	return len;
+#endif
+#ifdef WITH_AF_XDP
+	if (ssock->xdp.fd >= 0) {
+		void *xbufs[1] = { buf };
+		if (xdp_send (&ssock->xdp, ssock->sd, xbufs, &len, 1, ssock->stats) < 0)
+			return SC_ABORT;
+		return len;
+	}
+#endif
+
+	while (1) {
+		nwritten = send (ssock->sd, buf, len, MSG_DONTWAIT);
 		i++;
-	} while ((nwritten < 0) && ((errno == EINTR) || (errno == EAGAIN)));
+		if ((nwritten >= 0) || (errno != EAGAIN && errno != EINTR))
+			break;
+		if (errno == EAGAIN)
+			sock_wait_tx (ssock);
+	}
 
-	if (i > 1)
-		printf ("%d times buffer full on write\n", i);
 	if (nwritten == -1) {
 		perror ("Could not write to socket");
 		assert (nwritten != -1);
 	}
+#ifdef WITH_TIMESTAMPING
+	struct iovec iov = { buf, len };
+	sock_ts_sent (ssock, &iov, 1);
+#endif
+
+	if (ssock->stats) {
+		ssock->stats->nr_tx_syscalls += i;
+		ssock->stats->nr_sent++;
+	}
 
 	if (nwritten < ((__s32) len))
 		return SC_ABORT;
 	return nwritten;
 }
 
+static inline size_t sock_msg_len (struct msghdr const *msg)
+{
+	size_t j, len = 0;
+
+	for (j = 0; j < msg->msg_iovlen; j++)
+		len += msg->msg_iov[j].iov_len;
+	return len;
+}
+
+#ifdef WITH_ZEROCOPY
+/* moves the completion watermark over the completed send ids lo..hi */
+static void sock_zc_complete (struct sctp_sock *ssock, __u32 lo, __u32 hi)
+{
+	__u32 i;
+
+	if (lo != ssock->zc_done) {
+		/* completed out of order, keep it until the gap is closed */
+		if (ssock->zc_nranges == SOCK_ZC_RANGES) {
+			SCTRL_LOG_ERROR("Too many zerocopy completions out of order, frames are held back");
+			return;
+		}
+		ssock->zc_ranges[ssock->zc_nranges][0] = lo;
+		ssock->zc_ranges[ssock->zc_nranges][1] = hi;
+		ssock->zc_nranges++;
+		return;
+	}
+	ssock->zc_done = hi + 1;
+	for (i = 0; i < ssock->zc_nranges; i++) {
+		if (ssock->zc_ranges[i][0] == ssock->zc_done) {
+			ssock->zc_done = ssock->zc_ranges[i][1] + 1;
+			ssock->zc_ranges[i][0] = ssock->zc_ranges[--ssock->zc_nranges][0];
+			ssock->zc_ranges[i][1] = ssock->zc_ranges[ssock->zc_nranges][1];
+			i = -1; /* rescan */
+		}
+	}
+}
+#endif
+
+#if defined(WITH_ZEROCOPY) || defined(WITH_TIMESTAMPING)
+/* processes the error queue (zerocopy completions, TX timestamps) without blocking
+ * returns number of zerocopy sends completed*/
+static __s32 sock_errqueue (struct sctp_sock *ssock)
+{
+	struct msghdr msg;
+	struct cmsghdr *cm;
+	struct sock_extended_err *serr;
+	__u8 ctrl[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in)) +
+	          CMSG_SPACE(3 * sizeof(struct timespec))];
+	__s32 done = 0;
+#ifdef WITH_ZEROCOPY
+	__u32 lo, hi, id;
+	__u64 now = spin_clock ();
+#endif
+
+	while (1) {
+		memset (&msg, 0, sizeof(msg));
+		msg.msg_control = ctrl;
+		msg.msg_controllen = sizeof(ctrl);
+		if (recvmsg (ssock->sd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			break;
+		for (cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+			if ((cm->cmsg_level != SOL_IP) || (cm->cmsg_type != IP_RECVERR))
+				continue;
+			serr = (struct sock_extended_err *) CMSG_DATA(cm);
+#ifdef WITH_TIMESTAMPING
+			if (serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+				sock_ts_complete (ssock, serr->ee_data, sock_cmsg_tstamp (&msg));
+				continue;
+			}
+#endif
+#ifdef WITH_ZEROCOPY
+			if ((serr->ee_errno != 0) || (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY))
+				continue;
+			lo = serr->ee_info;
+			hi = serr->ee_data;
+			if (ssock->stats) {
+				for (id = lo; id != hi + 1; id++) {
+					if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+						ssock->stats->nr_zc_copied++;
+					else
+						ssock->stats->bytes_zc_saved += ssock->zc_len[id % SOCK_ZC_TRACK];
+					ssock->stats->ns_zc_latency += now - ssock->zc_time[id % SOCK_ZC_TRACK];
+				}
+				ssock->stats->nr_zc_completions += hi - lo + 1;
+			}
+			sock_zc_complete (ssock, lo, hi);
+			done += hi - lo + 1;
+#endif
+		}
+	}
+	return done;
+}
+#endif
+
+#ifdef WITH_ZEROCOPY
+__s32 sock_zc_reap (struct sctp_sock *ssock)
+{
+	if (!ssock->zc || (ssock->zc_done == ssock->zc_next))
+		return 0;
+	return sock_errqueue (ssock);
+}
+#endif
+
+#ifdef WITH_TIMESTAMPING
+__u32 sock_tx_tstamps (struct sctp_sock *ssock, void **frames, __u64 *ts, __u32 num)
+{
+	__u32 i;
+
+	if (!ssock->ts)
+		return 0;
+	if (ssock->ts_done_num < num)
+		sock_errqueue (ssock);
+	for (i = 0; (i < num) && (ssock->ts_done_num > 0); i++) {
+		frames[i] = ssock->ts_done_frame[ssock->ts_done_head];
+		ts[i] = ssock->ts_done[ssock->ts_done_head];
+		ssock->ts_done_head = (ssock->ts_done_head + 1) % SOCK_TS_TRACK;
+		ssock->ts_done_num--;
+	}
+	return i;
+}
+#endif
+
+static void sock_wait_tx (struct sctp_sock *ssock)
+{
+	struct pollfd pfd;
+	__u64 start = spin_clock ();
+	int ret;
+
+	pfd.fd = ssock->sd;
+	pfd.events = POLLOUT;
+	pfd.revents = 0;
+	ret = poll (&pfd, 1, SOCK_TX_WAIT_MS);
+	if (ret == 0)
+		SCTRL_LOG_WARN ("Socket buffer still full after %d ms, retrying send", SOCK_TX_WAIT_MS);
+#if defined(WITH_ZEROCOPY) || defined(WITH_TIMESTAMPING)
+	/* a pending error queue wakes us up as well, empty it or we would not wait at all */
+	if ((ret > 0) && (pfd.revents & POLLERR))
+		sock_errqueue (ssock);
+#endif
+	if (ssock->stats) {
+		ssock->stats->nr_tx_blocked++;
+		ssock->stats->ns_tx_blocked += spin_clock () - start;
+	}
+}
+
+/* sends num messages, continues where the kernel stopped early (e.g. full socket buffer)
+ * returns number of messages sent (SC_ABORT on error, errno is preserved)*/
+static __s32 sock_sendmmsg (struct sctp_sock *ssock, struct mmsghdr *msgs, __u32 num)
+{
+	__u32 i, n, sent = 0;
+	__s32 ret;
+	size_t len;
+	int flags;
+
+	while (sent < num) {
+		n = num - sent;
+		flags = MSG_DONTWAIT;
+#ifdef WITH_ZEROCOPY
+		/* runs of large messages are sent zerocopy, the others are copied */
+		if (ssock->zc) {
+			bool zc = (sock_msg_len (&msgs[sent].msg_hdr) >= SOCK_ZC_MIN_BYTES);
+			for (n = 1; (sent + n < num) && ((sock_msg_len (&msgs[sent + n].msg_hdr) >= SOCK_ZC_MIN_BYTES) == zc); n++);
+			if (zc)
+				flags |= MSG_ZEROCOPY;
+		}
+#endif
+		ret = sendmmsg (ssock->sd, msgs + sent, n, flags);
+		if (ssock->stats)
+			ssock->stats->nr_tx_syscalls++;
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN) {
+				sock_wait_tx (ssock);
+				continue;
+			}
+#ifdef WITH_ZEROCOPY
+			/* too many completions pending (optmem limit), collect them */
+			if ((errno == ENOBUFS) && (flags & MSG_ZEROCOPY)) {
+				sock_zc_reap (ssock);
+				continue;
+			}
+#endif
+			return SC_ABORT;
+		}
+		for (i = sent; i < sent + (__u32) ret; i++) {
+			len = sock_msg_len (&msgs[i].msg_hdr);
+			if (msgs[i].msg_len < len) {
+				errno = EMSGSIZE;
+				return SC_ABORT;
+			}
+#ifdef WITH_TIMESTAMPING
+			sock_ts_sent (ssock, msgs[i].msg_hdr.msg_iov, msgs[i].msg_hdr.msg_iovlen);
+#endif
+#ifdef WITH_ZEROCOPY
+			if (flags & MSG_ZEROCOPY) {
+				/* every message sent zerocopy gets the next id */
+				ssock->zc_len[ssock->zc_next % SOCK_ZC_TRACK] = len;
+				ssock->zc_time[ssock->zc_next % SOCK_ZC_TRACK] = spin_clock ();
+				ssock->zc_next++;
+			}
+#endif
+		}
+		sent += ret;
+	}
+	return sent;
+}
+
+template <typename arq_frame>
+__s32 sock_write_batch (struct sctp_sock *ssock, arq_frame **bufs, __u32 const *len, __u32 num)
+{
+	struct mmsghdr msgs[SOCK_MAX_BATCH];
+	struct iovec iovs[SOCK_MAX_BATCH];
+	__u32 i;
+	__s32 ret;
+#ifdef WITH_UDP_GSO
+	__u8 ctrl[SOCK_MAX_BATCH][CMSG_SPACE(sizeof(__u16))];
+	struct cmsghdr *cm;
+	__u32 j, nmsgs, total;
+#endif
+
+	assert (num <= SOCK_MAX_BATCH);
+
+	for (i = 0; i < num; i++) {
+		iovs[i].iov_base = bufs[i];
+		iovs[i].iov_len = len[i];
+		if ((len[i] < MIN_PACKET_SEND_SIZE) && (len[i] != sizeof(struct arq_ackframe)))
+			iovs[i].iov_len = MIN_PACKET_SEND_SIZE;
+	}
+
+	if (ssock->tp) {
+		__u32 lens[SOCK_MAX_BATCH];
+		for (i = 0; i < num; i++)
+			lens[i] = iovs[i].iov_len;
+		return ssock->tp->write_batch (ssock, (void *const *) bufs, lens, num);
+	}
+
+#ifdef WITH_IO_URING
+	__u32 lens[SOCK_MAX_BATCH];
+	for (i = 0; i < num; i++)
+		lens[i] = iovs[i].iov_len;
+	return uring_send (&ssock->uring, ssock->sd, (void *const *) bufs, lens, num, ssock->stats);
+#endif
+#ifdef WITH_AF_XDP
+	if (ssock->xdp.fd >= 0) {
+		__u32 lens[SOCK_MAX_BATCH];
+		for (i = 0; i < num; i++)
+			lens[i] = iovs[i].iov_len;
+		return xdp_send (&ssock->xdp, ssock->sd, (void *const *) bufs, lens, num, ssock->stats);
+	}
+#endif
+
+#ifdef WITH_UDP_GSO
+	if (ssock->gso && (num > 1)) {
+		/* every run of equally sized frames (plus one shorter frame at its end) becomes one
+		 * message; the frames are not contiguous, so the message gathers them by iovec */
+		memset (msgs, 0, sizeof(struct mmsghdr) * num);
+		nmsgs = 0;
+		for (i = 0; i < num; i = j) {
+			total = iovs[i].iov_len;
+			for (j = i + 1; (j < num) && (j - i < SOCK_GSO_MAX_SEGS) && (total + iovs[j].iov_len <= SOCK_GSO_MAX_BYTES); j++) {
+				if (iovs[j].iov_len > iovs[i].iov_len)
+					break;
+				total += iovs[j].iov_len;
+				if (iovs[j].iov_len < iovs[i].iov_len) {
+					j++;
+					break;
+				}
+			}
+			msgs[nmsgs].msg_hdr.msg_iov = &iovs[i];
+			msgs[nmsgs].msg_hdr.msg_iovlen = j - i;
+			if (j - i > 1) {
+				msgs[nmsgs].msg_hdr.msg_control = ctrl[nmsgs];
+				msgs[nmsgs].msg_hdr.msg_controllen = sizeof(ctrl[nmsgs]);
+				cm = CMSG_FIRSTHDR(&msgs[nmsgs].msg_hdr);
+				cm->cmsg_level = SOL_UDP;
+				cm->cmsg_type = UDP_SEGMENT;
+				cm->cmsg_len = CMSG_LEN(sizeof(__u16));
+				*((__u16 *) CMSG_DATA(cm)) = iovs[i].iov_len;
+			}
+			nmsgs++;
+		}
+
+		ret = sock_sendmmsg (ssock, msgs, nmsgs);
+		if (ret >= 0) {
+			if (ssock->stats)
+				ssock->stats->nr_sent += num;
+			return num;
+		}
+		if ((errno != EIO) && (errno != EINVAL) && (errno != ENOPROTOOPT) && (errno != EOPNOTSUPP)) {
+			perror ("Could not write to socket");
+			return SC_ABORT;
+		}
+		/* the kernel (or device) refuses segmentation: fall back to one datagram per frame
+		 * NOTE: frames of messages sent before the failure are sent twice, the receiver drops duplicates */
+		SCTRL_LOG_WARN ("UDP segmentation offload refused (%s), sending without", strerror(errno));
+		ssock->gso = 0;
+	}
+#endif
+
+	memset (msgs, 0, sizeof(struct mmsghdr) * num);
+	for (i = 0; i < num; i++) {
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	ret = sock_sendmmsg (ssock, msgs, num);
+	if (ret < 0) {
+		perror ("Could not write to socket");
+		return SC_ABORT;
+	}
+	if (ssock->stats)
+		ssock->stats->nr_sent += ret;
+
+	return ret;
+}
+
+__s32 sock_write_reset (struct sctp_sock *ssock, void const *buf, __u32 len)
+{
+	struct sockaddr_in reset_addr;
+	__s32 ret;
+
+	if (ssock->tp)
+		return ssock->tp->write_reset (ssock, buf, len);
+
+	memset(&reset_addr, 0, sizeof(reset_addr));
+	reset_addr.sin_family = AF_INET;
+	reset_addr.sin_port = htons(ssock->udp_port_reset);
+	reset_addr.sin_addr.s_addr = ssock->remote_ip;
+	ret = sendto(ssock->sd, buf, len, /*flags*/ 0, (struct sockaddr *)&reset_addr, sizeof(reset_addr));
+#ifdef WITH_TIMESTAMPING
+	/* the send consumed a timestamp key, no frames of the window belong to it */
+	if (ret > 0)
+		ssock->ts_nframes[ssock->ts_next++ % SOCK_TS_TRACK] = 0;
+#endif
+	if (ret < 0)
+		return SC_ABORT;
+	return ret;
+}
+
 __s32 sock_writev (struct sctp_sock *ssock, const struct iovec *iov, int iovcnt)
 {
+	struct msghdr msg;
 	__s32 nwritten, len = 0;
 	int i;
 
@@ -428,14 +1492,13 @@ __s32 sock_writev (struct sctp_sock *ssock, const struct iovec *iov, int iovcnt)
 		len += iov[i].iov_len;
 	}
 
-	i = 0;
-	errno = 0;
-	do {
-		nwritten = writev (ssock->sd, iov, iovcnt);
-		i++;
-	} while (errno == EAGAIN);
-	if (i > 1)
-		printf ("%d times buffer full on write\n", i);
+	memset (&msg, 0, sizeof(msg));
+	msg.msg_iov = (struct iovec *) iov;
+	msg.msg_iovlen = iovcnt;
+	while (((nwritten = sendmsg (ssock->sd, &msg, MSG_DONTWAIT)) < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+		if (errno == EAGAIN)
+			sock_wait_tx (ssock);
+	}
 	assert (nwritten != -1);
 	if (nwritten <  len)
 		return SC_ABORT;
@@ -477,8 +1540,13 @@ template __s32 debug_write (struct sctp_sock *ssock, struct arq_frame<> *buf, __
 
 #define PARAMETERISATION(Name, name)                                                               \
 	template void print_stats<Name>();                                                             \
+	template __u32 sock_provide_rx(sctp_sock* ssock, arq_frame<Name>** bufs, __u32 num);           \
 	template __s32 sock_read(sctp_sock* ssock, arq_frame<Name>* buf, __u8 filter);                 \
-	template __s32 sock_write(sctp_sock* ssock, arq_frame<Name>* buf, __u32 len);
+	template __s32 sock_read_batch(                                                                \
+	    sctp_sock* ssock, arq_frame<Name>** bufs, __s32* nread, __u32 num);                        \
+	template __s32 sock_write(sctp_sock* ssock, arq_frame<Name>* buf, __u32 len);                  \
+	template __s32 sock_write_batch(                                                               \
+	    sctp_sock* ssock, arq_frame<Name>** bufs, __u32 const* len, __u32 num);
 #include "sctrltp/parameters.def"
 
 } // namespace sctrltp
@@ -0,0 +1,381 @@
+/* io_uring transport backend (see us_sctp_uring.h)
+ * */
+
+#include "sctrltp/us_sctp_uring.h"
+
+#ifdef WITH_IO_URING
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+
+#include "sctrltp/us_sctp_defs.h"
+#include "sctrltp/sctp_atomic.h"
+#include "sctrltp/logger.h"
+
+namespace sctrltp {
+
+/* idle time of the kernel side SQ poll thread before it has to be woken up again */
+#define URING_SQ_THREAD_IDLE_MS 50
+/* completion queue size of the receive ring (one CQE per datagram) */
+#define URING_RX_CQ_ENTRIES (4 * URING_RX_BUFS)
+/* number of polls of the completion queue before we go to sleep in io_uring_enter (SQPOLL only) */
+#define URING_TX_SPIN 4096
+
+#define load_acquire(p)     __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+
+static __s32 queue_init (struct uring_queue *q, __u32 entries, struct io_uring_params *p)
+{
+	memset (q, 0, sizeof(struct uring_queue));
+
+	q->fd = syscall (__NR_io_uring_setup, entries, p);
+	if (q->fd < 0) {
+		perror ("io_uring_setup failed");
+		return SC_ABORT;
+	}
+	q->features = p->features;
+	q->setup_flags = p->flags;
+
+	q->sq_ring_sz = p->sq_off.array + p->sq_entries * sizeof(__u32);
+	q->cq_ring_sz = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		if (q->cq_ring_sz > q->sq_ring_sz)
+			q->sq_ring_sz = q->cq_ring_sz;
+		q->cq_ring_sz = q->sq_ring_sz;
+	}
+
+	q->sq_ring_ptr = mmap (0, q->sq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->fd, IORING_OFF_SQ_RING);
+	if (q->sq_ring_ptr == MAP_FAILED) {
+		perror ("mapping io_uring SQ ring failed");
+		return SC_ABORT;
+	}
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		q->cq_ring_ptr = q->sq_ring_ptr;
+	} else {
+		q->cq_ring_ptr = mmap (0, q->cq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->fd, IORING_OFF_CQ_RING);
+		if (q->cq_ring_ptr == MAP_FAILED) {
+			perror ("mapping io_uring CQ ring failed");
+			return SC_ABORT;
+		}
+	}
+	q->sqes_sz = p->sq_entries * sizeof(struct io_uring_sqe);
+	q->sqes = (struct io_uring_sqe *) mmap (0, q->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->fd, IORING_OFF_SQES);
+	if (q->sqes == MAP_FAILED) {
+		perror ("mapping io_uring SQEs failed");
+		return SC_ABORT;
+	}
+
+	q->sq_head  = (__u32 *)((__u8 *)q->sq_ring_ptr + p->sq_off.head);
+	q->sq_tail  = (__u32 *)((__u8 *)q->sq_ring_ptr + p->sq_off.tail);
+	q->sq_mask  = (__u32 *)((__u8 *)q->sq_ring_ptr + p->sq_off.ring_mask);
+	q->sq_flags = (__u32 *)((__u8 *)q->sq_ring_ptr + p->sq_off.flags);
+	q->sq_array = (__u32 *)((__u8 *)q->sq_ring_ptr + p->sq_off.array);
+	q->cq_head  = (__u32 *)((__u8 *)q->cq_ring_ptr + p->cq_off.head);
+	q->cq_tail  = (__u32 *)((__u8 *)q->cq_ring_ptr + p->cq_off.tail);
+	q->cq_mask  = (__u32 *)((__u8 *)q->cq_ring_ptr + p->cq_off.ring_mask);
+	q->cqes     = (struct io_uring_cqe *)((__u8 *)q->cq_ring_ptr + p->cq_off.cqes);
+	q->sq_local_tail = *q->sq_tail;
+
+	return 0;
+}
+
+/* returns a cleared SQE (caller has to make sure the ring is not full) */
+static inline struct io_uring_sqe *queue_get_sqe (struct uring_queue *q)
+{
+	__u32 idx = q->sq_local_tail & *q->sq_mask;
+	struct io_uring_sqe *sqe = &q->sqes[idx];
+
+	memset (sqe, 0, sizeof(struct io_uring_sqe));
+	q->sq_array[idx] = idx;
+	q->sq_local_tail++;
+	return sqe;
+}
+
+/* publishes prepared SQEs and enters the kernel if necessary (to submit, to wait for min_complete
+ * completions or to wake up the SQ poll thread)
+ * returns number of syscalls done (0 or 1), SC_ABORT on error*/
+static __s32 queue_enter (struct uring_queue *q, __u32 min_complete)
+{
+	__u32 flags = 0;
+	__s32 ret;
+
+	q->sq_pending += q->sq_local_tail - *q->sq_tail;
+	store_release (q->sq_tail, q->sq_local_tail);
+
+	if (q->setup_flags & IORING_SETUP_SQPOLL) {
+		/* the poll thread picks up new SQEs on its own, unless it went to sleep */
+		__atomic_thread_fence (__ATOMIC_SEQ_CST);
+		if (q->sq_pending && (load_acquire (q->sq_flags) & IORING_SQ_NEED_WAKEUP))
+			flags |= IORING_ENTER_SQ_WAKEUP;
+		q->sq_pending = 0;
+		if (min_complete)
+			flags |= IORING_ENTER_GETEVENTS;
+		if (!flags)
+			return 0;
+		do {
+			ret = syscall (__NR_io_uring_enter, q->fd, 0, min_complete, flags, NULL, 0);
+		} while ((ret < 0) && (errno == EINTR));
+	} else {
+		if (min_complete)
+			flags |= IORING_ENTER_GETEVENTS;
+		if (!flags && !q->sq_pending)
+			return 0;
+		do {
+			ret = syscall (__NR_io_uring_enter, q->fd, q->sq_pending, min_complete, flags, NULL, 0);
+		} while ((ret < 0) && (errno == EINTR));
+		if (ret >= 0)
+			q->sq_pending -= ret;
+	}
+
+	if (ret < 0) {
+		SCTRL_LOG_ERROR("io_uring_enter failed: %s", strerror(errno));
+		return SC_ABORT;
+	}
+	return 1;
+}
+
+__s8 uring_init (struct sctp_uring *ur, __s32 sd)
+{
+	struct io_uring_params p;
+	struct io_uring_buf_reg reg;
+	size_t len;
+	__s32 ret;
+
+	(void) sd;
+	memset (ur, 0, sizeof(struct sctp_uring));
+
+	/* transmit ring: optionally with a kernel side poll thread to avoid io_uring_enter */
+	memset (&p, 0, sizeof(p));
+#ifdef WITH_IO_URING_SQPOLL
+	p.flags |= IORING_SETUP_SQPOLL;
+	p.sq_thread_idle = URING_SQ_THREAD_IDLE_MS;
+#endif
+	if (queue_init (&ur->tx, URING_TX_ENTRIES, &p) < 0)
+		return SC_ABORT;
+
+	/* receive ring: a single multishot receive, but a lot of completions */
+	memset (&p, 0, sizeof(p));
+	p.flags |= IORING_SETUP_CQSIZE;
+	p.cq_entries = URING_RX_CQ_ENTRIES;
+	if (queue_init (&ur->rx, 4, &p) < 0)
+		return SC_ABORT;
+
+	/* provided buffer ring (group 0) feeding the multishot receive */
+	len = URING_RX_BUFS * sizeof(struct io_uring_buf);
+	ur->bufring = (struct io_uring_buf_ring *) mmap (0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ur->bufring == MAP_FAILED) {
+		perror ("allocating io_uring buffer ring failed");
+		return SC_ABORT;
+	}
+	memset (&reg, 0, sizeof(reg));
+	reg.ring_addr = (__u64)(unsigned long) ur->bufring;
+	reg.ring_entries = URING_RX_BUFS;
+	reg.bgid = 0;
+	ret = syscall (__NR_io_uring_register, ur->rx.fd, IORING_REGISTER_PBUF_RING, &reg, 1);
+	if (ret < 0) {
+		perror ("registering io_uring buffer ring failed (kernel >= 5.19 needed)");
+		return SC_ABORT;
+	}
+
+	SCTRL_LOG_INFO ("io_uring backend up (SQPOLL: %s)", (ur->tx.setup_flags & IORING_SETUP_SQPOLL) ? "on" : "off");
+	return 0;
+}
+
+void uring_register_pool (struct sctp_uring *ur, void *base, size_t len)
+{
+	struct iovec iov;
+	__s32 ret;
+
+	ur->pool_base = (__u8 *) base;
+	ur->pool_len = len;
+
+	iov.iov_base = base;
+	iov.iov_len = len;
+	ret = syscall (__NR_io_uring_register, ur->tx.fd, IORING_REGISTER_BUFFERS, &iov, 1);
+	if (ret < 0) {
+		SCTRL_LOG_WARN ("Could not register frame pool as fixed buffer (%s), sending without", strerror(errno));
+		return;
+	}
+	ur->fixed_reg = 1;
+}
+
+static inline __u8 in_pool (struct sctp_uring *ur, void *buf)
+{
+	return ((__u8 *)buf >= ur->pool_base) && ((__u8 *)buf < ur->pool_base + ur->pool_len);
+}
+
+/* puts a buffer (back) into the provided buffer ring, visible to kernel after store_release of tail */
+static inline void bufring_add (struct sctp_uring *ur, void *buf, __u16 bid)
+{
+	/* NOTE: not using bufring->bufs, __DECLARE_FLEX_ARRAY shifts it by 8 bytes when compiled as C++ */
+	struct io_uring_buf *b = ((struct io_uring_buf *) ur->bufring) + (ur->bufring_tail & (URING_RX_BUFS - 1));
+
+	b->addr = (__u64)(unsigned long) buf;
+	b->len = ur->rx_buflen;
+	b->bid = bid;
+	ur->bufring_tail++;
+}
+
+__u32 uring_provide_rx (struct sctp_uring *ur, void **bufs, __u32 num, __u32 buflen)
+{
+	__u32 taken = 0;
+
+	ur->rx_buflen = buflen;
+	while ((ur->rx_provided < URING_RX_BUFS) && (taken < num)) {
+		taken++;
+		ur->rx_bufs[ur->rx_provided] = bufs[num - taken];
+		bufring_add (ur, bufs[num - taken], ur->rx_provided);
+		ur->rx_provided++;
+	}
+	store_release (&ur->bufring->tail, ur->bufring_tail);
+	return taken;
+}
+
+__u8 uring_rx_ready (struct sctp_uring *ur)
+{
+	return (*ur->rx.cq_head != load_acquire (ur->rx.cq_tail));
+}
+
+__s32 uring_recv (struct sctp_uring *ur, __s32 sd, void **bufs, __s32 *nread, __u32 num, __u8 exchange)
+{
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	__u32 head, tail, got = 0;
+	__u16 bid;
+	void *filled;
+
+	while (got == 0) {
+		if (!ur->rx_armed) {
+			/* (re)post multishot receive, it stays active until it runs out of buffers */
+			sqe = queue_get_sqe (&ur->rx);
+			sqe->opcode = IORING_OP_RECV;
+			sqe->fd = sd;
+			sqe->ioprio = IORING_RECV_MULTISHOT;
+			sqe->flags = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = 0;
+			ur->rx_armed = 1;
+		}
+
+		head = *ur->rx.cq_head;
+		if (head == load_acquire (ur->rx.cq_tail)) {
+			if (queue_enter (&ur->rx, 1) < 0)
+				return SC_ABORT;
+		}
+
+		tail = load_acquire (ur->rx.cq_tail);
+		while ((head != tail) && (got < num)) {
+			cqe = &ur->rx.cqes[head & *ur->rx.cq_mask];
+			head++;
+			if (!(cqe->flags & IORING_CQE_F_MORE))
+				ur->rx_armed = 0;
+			if (cqe->res < 0) {
+				/* out of buffers: we re-arm after we gave back buffers */
+				if ((cqe->res == -ENOBUFS) || (cqe->res == -EINTR))
+					continue;
+				store_release (ur->rx.cq_head, head);
+				SCTRL_LOG_ERROR("Failed to read from socket: %s\n", strerror(-cqe->res));
+				return SC_ABORT;
+			}
+			if (!(cqe->flags & IORING_CQE_F_BUFFER))
+				continue;
+
+			bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+			filled = ur->rx_bufs[bid];
+			if (exchange && in_pool (ur, bufs[got])) {
+				/* exchange frames: the empty one takes over the buffer id */
+				ur->rx_bufs[bid] = bufs[got];
+				bufs[got] = filled;
+			} else {
+				memcpy (bufs[got], filled, cqe->res);
+			}
+			bufring_add (ur, ur->rx_bufs[bid], bid);
+			nread[got] = cqe->res;
+			got++;
+		}
+		store_release (ur->rx.cq_head, head);
+		store_release (&ur->bufring->tail, ur->bufring_tail);
+	}
+
+	return got;
+}
+
+__s32 uring_send (struct sctp_uring *ur, __s32 sd, void *const *bufs, __u32 const *len, __u32 num,
+                  struct sctp_stats *stats)
+{
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	__u32 i, head, done = 0;
+	__s32 ret = num;
+	__s32 calls;
+	__u32 spin = 0;
+
+	if (num > URING_TX_ENTRIES)
+		return SC_ABORT;
+
+	spin_lock (&ur->txlock);
+
+	for (i = 0; i < num; i++) {
+		sqe = queue_get_sqe (&ur->tx);
+		sqe->fd = sd;
+		sqe->addr = (__u64)(unsigned long) bufs[i];
+		sqe->len = len[i];
+		sqe->user_data = i;
+		if (ur->fixed_reg && in_pool (ur, bufs[i])) {
+			/* write on a connected datagram socket sends one datagram */
+			sqe->opcode = IORING_OP_WRITE_FIXED;
+			sqe->buf_index = 0;
+		} else {
+			sqe->opcode = IORING_OP_SEND;
+		}
+	}
+
+	/* submit (and wait for completions unless a poll thread does the work) */
+	calls = queue_enter (&ur->tx, (ur->tx.setup_flags & IORING_SETUP_SQPOLL) ? 0 : num);
+	if (calls < 0) {
+		spin_unlock (&ur->txlock);
+		return SC_ABORT;
+	}
+	if (stats)
+		stats->nr_tx_syscalls += calls;
+
+	/* frames must not be handed back before the kernel is done with them */
+	head = *ur->tx.cq_head;
+	while (done < num) {
+		if (head == load_acquire (ur->tx.cq_tail)) {
+			if (++spin < URING_TX_SPIN)
+				continue;
+			calls = queue_enter (&ur->tx, num - done);
+			if (calls < 0) {
+				spin_unlock (&ur->txlock);
+				return SC_ABORT;
+			}
+			if (stats)
+				stats->nr_tx_syscalls += calls;
+			continue;
+		}
+		cqe = &ur->tx.cqes[head & *ur->tx.cq_mask];
+		if ((cqe->res < 0) || ((__u32) cqe->res < len[cqe->user_data])) {
+			if (cqe->res < 0)
+				SCTRL_LOG_ERROR("Could not write to socket: %s", strerror(-cqe->res));
+			ret = SC_ABORT;
+		}
+		head++;
+		done++;
+	}
+	store_release (ur->tx.cq_head, head);
+	if (stats)
+		stats->nr_sent += num;
+
+	spin_unlock (&ur->txlock);
+	return ret;
+}
+
+} // namespace sctrltp
+
+#endif // WITH_IO_URING
@@ -0,0 +1,531 @@
+/* AF_XDP transport backend (see us_sctp_xdp.h)
+ * */
+
+#include "sctrltp/us_sctp_xdp.h"
+
+#ifdef WITH_AF_XDP
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <net/if_arp.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_link.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+
+#include "sctrltp/us_sctp_defs.h"
+#include "sctrltp/us_sctp_bpf.h"
+#include "sctrltp/sctp_atomic.h"
+#include "sctrltp/logger.h"
+
+namespace sctrltp {
+
+#define load_acquire(p)     __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+
+/* smallest Ethernet frame (without FCS), shorter frames are padded */
+#define ETH_MIN_LEN 60
+
+/* loads the XDP program redirecting IPv4/UDP frames from remote_ip:remote_port to local_port into
+ * the XSK registered for the receiving queue (all values in network byte order)*/
+static __s32 load_prog (struct sctp_xdp *xdp)
+{
+	/* offset of the jump target "pass" relative to the instruction following instruction pc */
+	#define PASS(pc) ((__s16)(24 - ((pc) + 1)))
+	struct bpf_insn prog[] = {
+		insn (BPF_ALU64 | BPF_MOV | BPF_X, 6, 1, 0, 0),               /*  0: r6 = ctx */
+		insn (BPF_LDX | BPF_MEM | BPF_W, 2, 6, 0, 0),                  /*  1: r2 = ctx->data */
+		insn (BPF_LDX | BPF_MEM | BPF_W, 3, 6, 4, 0),                  /*  2: r3 = ctx->data_end */
+		insn (BPF_ALU64 | BPF_MOV | BPF_X, 4, 2, 0, 0),               /*  3: r4 = r2 */
+		insn (BPF_ALU64 | BPF_ADD | BPF_K, 4, 0, 0, XDP_HDR_LEN),     /*  4: r4 += headers */
+		insn (BPF_JMP | BPF_JGT | BPF_X, 4, 3, PASS(5), 0),           /*  5: too short? */
+		insn (BPF_LDX | BPF_MEM | BPF_H, 5, 2, 12, 0),                 /*  6: ethertype */
+		insn (BPF_JMP32 | BPF_JNE | BPF_K, 5, 0, PASS(7), htons(0x0800)),
+		insn (BPF_LDX | BPF_MEM | BPF_B, 5, 2, 14, 0),                 /*  8: IPv4 w/o options */
+		insn (BPF_JMP32 | BPF_JNE | BPF_K, 5, 0, PASS(9), 0x45),
+		insn (BPF_LDX | BPF_MEM | BPF_B, 5, 2, 23, 0),                 /* 10: UDP */
+		insn (BPF_JMP32 | BPF_JNE | BPF_K, 5, 0, PASS(11), IPPROTO_UDP),
+		insn (BPF_LDX | BPF_MEM | BPF_W, 5, 2, 26, 0),                 /* 12: source address */
+		insn (BPF_JMP32 | BPF_JNE | BPF_K, 5, 0, PASS(13), (__s32) xdp->remote_ip),
+		insn (BPF_LDX | BPF_MEM | BPF_H, 5, 2, 34, 0),                 /* 14: source port */
+		insn (BPF_JMP32 | BPF_JNE | BPF_K, 5, 0, PASS(15), xdp->remote_port),
+		insn (BPF_LDX | BPF_MEM | BPF_H, 5, 2, 36, 0),                 /* 16: destination port */
+		insn (BPF_JMP32 | BPF_JNE | BPF_K, 5, 0, PASS(17), xdp->local_port),
+		insn (BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, xdp->map_fd), /* 18: r1 = xsks map */
+		insn (0, 0, 0, 0, 0),
+		insn (BPF_LDX | BPF_MEM | BPF_W, 2, 6, 16, 0),                 /* 20: r2 = ctx->rx_queue_index */
+		insn (BPF_ALU64 | BPF_MOV | BPF_K, 3, 0, 0, XDP_PASS),        /* 21: no XSK on queue: pass */
+		insn (BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),    /* 22 */
+		insn (BPF_JMP | BPF_EXIT, 0, 0, 0, 0),                         /* 23 */
+		insn (BPF_ALU64 | BPF_MOV | BPF_K, 0, 0, 0, XDP_PASS),        /* 24: pass */
+		insn (BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+	};
+	#undef PASS
+	static char log[4096];
+	union bpf_attr attr;
+	__s32 fd;
+
+	memset (&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_XDP;
+	attr.insns = (__u64)(unsigned long) prog;
+	attr.insn_cnt = sizeof(prog) / sizeof(struct bpf_insn);
+	attr.license = (__u64)(unsigned long) "LGPL";
+	fd = sys_bpf (BPF_PROG_LOAD, &attr);
+	if (fd < 0) {
+		/* once more with verifier log */
+		attr.log_buf = (__u64)(unsigned long) log;
+		attr.log_size = sizeof(log);
+		attr.log_level = 1;
+		fd = sys_bpf (BPF_PROG_LOAD, &attr);
+		SCTRL_LOG_ERROR("Loading XDP program failed: %s", strerror(errno));
+		fprintf (stderr, "%s\n", log);
+	}
+	return fd;
+}
+
+static __s32 ring_map (struct xdp_ring *r, __s32 fd, struct xdp_ring_offset *off, __u32 size,
+                       size_t desc_size, off_t pgoff)
+{
+	r->map_len = off->desc + size * desc_size;
+	r->map = mmap (0, r->map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pgoff);
+	if (r->map == MAP_FAILED) {
+		perror ("mapping XSK ring failed");
+		return SC_ABORT;
+	}
+	r->producer = (__u32 *)((__u8 *)r->map + off->producer);
+	r->consumer = (__u32 *)((__u8 *)r->map + off->consumer);
+	r->flags = (__u32 *)((__u8 *)r->map + off->flags);
+	r->descs = (__u8 *)r->map + off->desc;
+	r->mask = size - 1;
+	r->cached_prod = *r->producer;
+	r->cached_cons = *r->consumer;
+	return 0;
+}
+
+/* finds the interface carrying the local address of the connected socket sd */
+static __s32 find_interface (struct sctp_xdp *xdp, __s32 sd)
+{
+	struct sockaddr_in local;
+	socklen_t len = sizeof(local);
+	struct ifaddrs *ifa, *i;
+	struct ifreq ifr;
+	struct ethtool_channels channels;
+
+	if (getsockname (sd, (struct sockaddr *)&local, &len) < 0) {
+		perror ("getsockname failed");
+		return SC_ABORT;
+	}
+	xdp->local_ip = local.sin_addr.s_addr;
+	xdp->local_port = local.sin_port;
+
+	if (getifaddrs (&ifa) < 0) {
+		perror ("getifaddrs failed");
+		return SC_ABORT;
+	}
+	xdp->ifname[0] = '\0';
+	for (i = ifa; i != NULL; i = i->ifa_next) {
+		if (i->ifa_addr && (i->ifa_addr->sa_family == AF_INET) &&
+		    (((struct sockaddr_in *)i->ifa_addr)->sin_addr.s_addr == xdp->local_ip)) {
+			strncpy (xdp->ifname, i->ifa_name, IF_NAMESIZE - 1);
+			xdp->ifname[IF_NAMESIZE - 1] = '\0';
+			break;
+		}
+	}
+	freeifaddrs (ifa);
+	xdp->ifindex = if_nametoindex (xdp->ifname);
+	if (xdp->ifindex == 0) {
+		SCTRL_LOG_ERROR("No interface found for local address of data socket");
+		return SC_ABORT;
+	}
+
+	memset (&ifr, 0, sizeof(ifr));
+	memcpy (ifr.ifr_name, xdp->ifname, IF_NAMESIZE);
+	if (ioctl (sd, SIOCGIFHWADDR, &ifr) < 0) {
+		perror ("getting MAC address failed");
+		return SC_ABORT;
+	}
+	memcpy (xdp->local_mac, ifr.ifr_hwaddr.sa_data, 6);
+
+	/* generic XDP does not see frames transmitted on loopback */
+	if ((ioctl (sd, SIOCGIFFLAGS, &ifr) == 0) && (ifr.ifr_flags & IFF_LOOPBACK)) {
+		SCTRL_LOG_WARN ("AF_XDP: %s is a loopback interface", xdp->ifname);
+		return SC_ABORT;
+	}
+
+	/* the XSK is bound to XDP_QUEUE_ID only: with more RX queues the flow may hash to another one and
+	 * pass to the UDP socket, which is not read while the backend is up (no answer: one queue) */
+	memset (&channels, 0, sizeof(channels));
+	channels.cmd = ETHTOOL_GCHANNELS;
+	ifr.ifr_data = (char *) &channels;
+	if ((ioctl (sd, SIOCETHTOOL, &ifr) == 0) && ((channels.rx_count + channels.combined_count) > 1)) {
+		SCTRL_LOG_WARN ("AF_XDP: %s has %u RX queues, only one is supported", xdp->ifname,
+		                channels.rx_count + channels.combined_count);
+		return SC_ABORT;
+	}
+	return 0;
+}
+
+/* looks up the FPGA's MAC in the neighbour table (the FPGA has to be on the local link) */
+static void resolve_remote (struct sctp_xdp *xdp, __s32 sd)
+{
+	struct arpreq req;
+	struct sockaddr_in *sin = (struct sockaddr_in *)&req.arp_pa;
+
+	memset (&req, 0, sizeof(req));
+	sin->sin_family = AF_INET;
+	sin->sin_addr.s_addr = xdp->remote_ip;
+	memcpy (req.arp_dev, xdp->ifname, sizeof(req.arp_dev));
+	if ((ioctl (sd, SIOCGARP, &req) == 0) && (req.arp_flags & ATF_COM)) {
+		memcpy (xdp->remote_mac, req.arp_ha.sa_data, 6);
+		xdp->remote_mac_valid = 1;
+		SCTRL_LOG_INFO ("AF_XDP: FPGA is at %02x:%02x:%02x:%02x:%02x:%02x on %s",
+		                xdp->remote_mac[0], xdp->remote_mac[1], xdp->remote_mac[2],
+		                xdp->remote_mac[3], xdp->remote_mac[4], xdp->remote_mac[5], xdp->ifname);
+	}
+}
+
+static void xdp_close (struct sctp_xdp *xdp)
+{
+	struct xdp_ring *rings[] = { &xdp->fill, &xdp->comp, &xdp->rx, &xdp->tx };
+	__u32 i;
+
+	if (xdp->link_fd >= 0)
+		close (xdp->link_fd);
+	if (xdp->prog_fd >= 0)
+		close (xdp->prog_fd);
+	if (xdp->map_fd >= 0)
+		close (xdp->map_fd);
+	for (i = 0; i < sizeof(rings) / sizeof(rings[0]); i++) {
+		if (rings[i]->map && (rings[i]->map != MAP_FAILED))
+			munmap (rings[i]->map, rings[i]->map_len);
+	}
+	if (xdp->fd >= 0)
+		close (xdp->fd);
+	if (xdp->umem && (xdp->umem != MAP_FAILED))
+		munmap (xdp->umem, (size_t) XDP_NR_CHUNKS * XDP_CHUNK_SIZE);
+	memset (xdp, 0, sizeof(struct sctp_xdp));
+	xdp->fd = xdp->prog_fd = xdp->map_fd = xdp->link_fd = -1;
+}
+
+static __s8 xdp_setup (struct sctp_xdp *xdp, __s32 sd)
+{
+	struct sockaddr_in remote;
+	socklen_t len = sizeof(remote);
+	struct xdp_umem_reg mr;
+	struct xdp_mmap_offsets off;
+	struct sockaddr_xdp sxdp;
+	union bpf_attr attr;
+	__u32 size = XDP_RING_SIZE;
+	__u32 key = XDP_QUEUE_ID;
+	__u32 i;
+	__u64 *fill;
+
+	if (getpeername (sd, (struct sockaddr *)&remote, &len) < 0) {
+		perror ("getpeername failed");
+		return SC_ABORT;
+	}
+	xdp->remote_ip = remote.sin_addr.s_addr;
+	xdp->remote_port = remote.sin_port;
+	if (find_interface (xdp, sd) < 0)
+		return SC_ABORT;
+
+	/* UMEM: first half of the chunks is handed to the fill ring, second half is for sending */
+	xdp->umem = (__u8 *) mmap (0, (size_t) XDP_NR_CHUNKS * XDP_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+	                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (xdp->umem == MAP_FAILED) {
+		perror ("allocating UMEM failed");
+		return SC_ABORT;
+	}
+
+	xdp->fd = socket (AF_XDP, SOCK_RAW, 0);
+	if (xdp->fd < 0) {
+		perror ("AF_XDP socket creation failed");
+		return SC_ABORT;
+	}
+	memset (&mr, 0, sizeof(mr));
+	mr.addr = (__u64)(unsigned long) xdp->umem;
+	mr.len = (__u64) XDP_NR_CHUNKS * XDP_CHUNK_SIZE;
+	mr.chunk_size = XDP_CHUNK_SIZE;
+	if (setsockopt (xdp->fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) ||
+	    setsockopt (xdp->fd, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size)) ||
+	    setsockopt (xdp->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size, sizeof(size)) ||
+	    setsockopt (xdp->fd, SOL_XDP, XDP_RX_RING, &size, sizeof(size)) ||
+	    setsockopt (xdp->fd, SOL_XDP, XDP_TX_RING, &size, sizeof(size))) {
+		perror ("setting up UMEM/XSK rings failed");
+		return SC_ABORT;
+	}
+	len = sizeof(off);
+	if (getsockopt (xdp->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &len)) {
+		perror ("getting XSK ring offsets failed");
+		return SC_ABORT;
+	}
+	if ((ring_map (&xdp->fill, xdp->fd, &off.fr, size, sizeof(__u64), XDP_UMEM_PGOFF_FILL_RING) < 0) ||
+	    (ring_map (&xdp->comp, xdp->fd, &off.cr, size, sizeof(__u64), XDP_UMEM_PGOFF_COMPLETION_RING) < 0) ||
+	    (ring_map (&xdp->rx, xdp->fd, &off.rx, size, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING) < 0) ||
+	    (ring_map (&xdp->tx, xdp->fd, &off.tx, size, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING) < 0))
+		return SC_ABORT;
+
+	fill = (__u64 *) xdp->fill.descs;
+	for (i = 0; i < XDP_NR_CHUNKS / 2; i++)
+		fill[(xdp->fill.cached_prod++) & xdp->fill.mask] = (__u64) i * XDP_CHUNK_SIZE;
+	store_release (xdp->fill.producer, xdp->fill.cached_prod);
+	for (i = 0; i < XDP_NR_CHUNKS / 2; i++)
+		xdp->tx_free[xdp->nr_tx_free++] = (__u64)(XDP_NR_CHUNKS / 2 + i) * XDP_CHUNK_SIZE;
+
+	memset (&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+	sxdp.sxdp_ifindex = xdp->ifindex;
+	sxdp.sxdp_queue_id = XDP_QUEUE_ID;
+	if (bind (xdp->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+		perror ("binding XSK to interface failed");
+		return SC_ABORT;
+	}
+
+	/* map: queue id -> XSK */
+	memset (&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_XSKMAP;
+	attr.key_size = sizeof(__u32);
+	attr.value_size = sizeof(__s32);
+	attr.max_entries = XDP_QUEUE_ID + 1;
+	xdp->map_fd = sys_bpf (BPF_MAP_CREATE, &attr);
+	if (xdp->map_fd < 0) {
+		perror ("creating XSK map failed");
+		return SC_ABORT;
+	}
+	memset (&attr, 0, sizeof(attr));
+	attr.map_fd = xdp->map_fd;
+	attr.key = (__u64)(unsigned long) &key;
+	attr.value = (__u64)(unsigned long) &xdp->fd;
+	if (sys_bpf (BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+		perror ("registering XSK in map failed");
+		return SC_ABORT;
+	}
+
+	xdp->prog_fd = load_prog (xdp);
+	if (xdp->prog_fd < 0)
+		return SC_ABORT;
+
+	/* attach (native if the driver supports it, generic otherwise); detached when we exit */
+	memset (&attr, 0, sizeof(attr));
+	attr.link_create.prog_fd = xdp->prog_fd;
+	attr.link_create.target_ifindex = xdp->ifindex;
+	attr.link_create.attach_type = BPF_XDP;
+	xdp->link_fd = sys_bpf (BPF_LINK_CREATE, &attr);
+	if (xdp->link_fd < 0) {
+		attr.link_create.flags = XDP_FLAGS_SKB_MODE;
+		xdp->link_fd = sys_bpf (BPF_LINK_CREATE, &attr);
+	}
+	if (xdp->link_fd < 0) {
+		perror ("attaching XDP program failed");
+		return SC_ABORT;
+	}
+
+	if (!xdp->remote_mac_valid)
+		resolve_remote (xdp, sd);
+	SCTRL_LOG_INFO ("AF_XDP backend up on %s queue %d", xdp->ifname, XDP_QUEUE_ID);
+	return 0;
+}
+
+__s8 xdp_init (struct sctp_xdp *xdp, __s32 sd)
+{
+	memset (xdp, 0, sizeof(struct sctp_xdp));
+	xdp->fd = xdp->prog_fd = xdp->map_fd = xdp->link_fd = -1;
+
+	if (xdp_setup (xdp, sd) < 0) {
+		xdp_close (xdp);
+		return SC_ABORT;
+	}
+	return 0;
+}
+
+__u8 xdp_rx_ready (struct sctp_xdp *xdp)
+{
+	return (load_acquire (xdp->rx.producer) != xdp->rx.cached_cons);
+}
+
+__s32 xdp_recv (struct sctp_xdp *xdp, void **bufs, __s32 *nread, __u32 num, __u32 buflen)
+{
+	struct xdp_desc *descs = (struct xdp_desc *) xdp->rx.descs;
+	__u64 *fill = (__u64 *) xdp->fill.descs;
+	struct pollfd pfd;
+	__u32 prod, got = 0;
+	__u8 *pkt;
+	__s32 len;
+
+	pfd.fd = xdp->fd;
+	pfd.events = POLLIN;
+
+	/* block only if the RX ring is empty */
+	while ((prod = load_acquire (xdp->rx.producer)) == xdp->rx.cached_cons) {
+		if ((poll (&pfd, 1, -1) < 0) && (errno != EINTR)) {
+			SCTRL_LOG_ERROR("Failed to poll XSK: %s\n", strerror(errno));
+			return SC_ABORT;
+		}
+	}
+
+	while ((xdp->rx.cached_cons != prod) && (got < num)) {
+		struct xdp_desc *d = &descs[xdp->rx.cached_cons & xdp->rx.mask];
+		xdp->rx.cached_cons++;
+
+		/* strip headers, the UDP length tells us about Ethernet padding */
+		pkt = xdp->umem + d->addr;
+		len = ntohs (*(__u16 *)(pkt + 14 + 20 + 4)) - 8;
+		if (len > (__s32)(d->len - XDP_HDR_LEN))
+			len = d->len - XDP_HDR_LEN;
+		if (len > (__s32) buflen)
+			len = buflen;
+		if (len < 0)
+			len = 0;
+		memcpy (bufs[got], pkt + XDP_HDR_LEN, len);
+		nread[got] = len;
+		got++;
+
+		/* chunk goes back to the kernel right away */
+		fill[(xdp->fill.cached_prod++) & xdp->fill.mask] = d->addr & ~((__u64) XDP_CHUNK_SIZE - 1);
+	}
+	store_release (xdp->rx.consumer, xdp->rx.cached_cons);
+	store_release (xdp->fill.producer, xdp->fill.cached_prod);
+	if (load_acquire (xdp->fill.flags) & XDP_RING_NEED_WAKEUP)
+		recvfrom (xdp->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+
+	return got;
+}
+
+/* collects sent chunks from the completion ring */
+static void reap_tx (struct sctp_xdp *xdp)
+{
+	__u64 *comp = (__u64 *) xdp->comp.descs;
+	__u32 prod = load_acquire (xdp->comp.producer);
+
+	while (xdp->comp.cached_cons != prod)
+		xdp->tx_free[xdp->nr_tx_free++] = comp[(xdp->comp.cached_cons++) & xdp->comp.mask];
+	store_release (xdp->comp.consumer, xdp->comp.cached_cons);
+}
+
+/* kicks the kernel to process the TX ring (always needed in copy mode)
+ * returns SC_ABORT on error*/
+static __s32 kick_tx (struct sctp_xdp *xdp, struct sctp_stats *stats)
+{
+	if (stats)
+		stats->nr_tx_syscalls++;
+	if ((sendto (xdp->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0) &&
+	    (errno != EAGAIN) && (errno != EBUSY) && (errno != ENOBUFS) && (errno != EINTR)) {
+		SCTRL_LOG_ERROR("Could not kick XSK TX: %s", strerror(errno));
+		return SC_ABORT;
+	}
+	return 0;
+}
+
+static inline __u16 ip_csum (const __u16 *hdr)
+{
+	__u32 sum = 0;
+	__u32 i;
+
+	for (i = 0; i < 10; i++)
+		sum += hdr[i];
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum;
+}
+
+__s32 xdp_send (struct sctp_xdp *xdp, __s32 sd, void *const *bufs, __u32 const *len, __u32 num,
+                struct sctp_stats *stats)
+{
+	struct xdp_desc *descs = (struct xdp_desc *) xdp->tx.descs;
+	__u8 *pkt;
+	__u16 *ip;
+	__u64 chunk;
+	__u32 i, plen;
+
+	spin_lock (&xdp->txlock);
+
+	if (!xdp->remote_mac_valid)
+		resolve_remote (xdp, sd);
+	if (!xdp->remote_mac_valid) {
+		/* the kernel stack resolves the FPGA's MAC for us meanwhile */
+		spin_unlock (&xdp->txlock);
+		for (i = 0; i < num; i++) {
+			if (stats)
+				stats->nr_tx_syscalls++;
+			if (write (sd, bufs[i], len[i]) != (__s32) len[i]) {
+				perror ("Could not write to socket");
+				return SC_ABORT;
+			}
+		}
+		if (stats)
+			stats->nr_sent += num;
+		return num;
+	}
+
+	reap_tx (xdp);
+	for (i = 0; i < num; i++) {
+		while (xdp->nr_tx_free == 0) {
+			store_release (xdp->tx.producer, xdp->tx.cached_prod);
+			if (kick_tx (xdp, stats) < 0) {
+				spin_unlock (&xdp->txlock);
+				return SC_ABORT;
+			}
+			reap_tx (xdp);
+		}
+		chunk = xdp->tx_free[--xdp->nr_tx_free];
+		pkt = xdp->umem + chunk;
+		plen = XDP_HDR_LEN + len[i];
+
+		/* Ethernet */
+		memcpy (pkt, xdp->remote_mac, 6);
+		memcpy (pkt + 6, xdp->local_mac, 6);
+		*(__u16 *)(pkt + 12) = htons(0x0800);
+		/* IPv4 (don't fragment, no options) */
+		ip = (__u16 *)(pkt + 14);
+		pkt[14] = 0x45;
+		pkt[15] = 0;
+		ip[1] = htons(20 + 8 + len[i]);
+		ip[2] = htons(xdp->ip_id++);
+		ip[3] = htons(0x4000);
+		pkt[22] = 64;
+		pkt[23] = IPPROTO_UDP;
+		ip[5] = 0;
+		memcpy (pkt + 26, &xdp->local_ip, 4);
+		memcpy (pkt + 30, &xdp->remote_ip, 4);
+		ip[5] = ip_csum (ip);
+		/* UDP (no checksum) */
+		*(__u16 *)(pkt + 34) = xdp->local_port;
+		*(__u16 *)(pkt + 36) = xdp->remote_port;
+		*(__u16 *)(pkt + 38) = htons(8 + len[i]);
+		*(__u16 *)(pkt + 40) = 0;
+		memcpy (pkt + XDP_HDR_LEN, bufs[i], len[i]);
+		if (plen < ETH_MIN_LEN) {
+			memset (pkt + plen, 0, ETH_MIN_LEN - plen);
+			plen = ETH_MIN_LEN;
+		}
+
+		descs[xdp->tx.cached_prod & xdp->tx.mask].addr = chunk;
+		descs[xdp->tx.cached_prod & xdp->tx.mask].len = plen;
+		descs[xdp->tx.cached_prod & xdp->tx.mask].options = 0;
+		xdp->tx.cached_prod++;
+	}
+	store_release (xdp->tx.producer, xdp->tx.cached_prod);
+	if (kick_tx (xdp, stats) < 0) {
+		spin_unlock (&xdp->txlock);
+		return SC_ABORT;
+	}
+	if (stats)
+		stats->nr_sent += num;
+
+	spin_unlock (&xdp->txlock);
+	return num;
+}
+
+} // namespace sctrltp
+
+#endif // WITH_AF_XDP
@@ -0,0 +1,315 @@
+/*Tests the memory transport (us_sctp_shm.h): frames between two endpoints of a link, a full ring,
+ * and a whole core talking to a minimal FPGA model over a link (no sockets involved)
+ *
+ * The core test also measures the frame rate of the software stack (user interface, queues,
+ * windows, core threads) without the kernel's network stack in the way.*/
+
+#include "sctrltp/build-config.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <endian.h>
+#include <sys/time.h>
+
+#include <gtest/gtest.h>
+
+#include "sctrltp/us_sctp_defs.h"
+#include "sctrltp/us_sctp_sock.h"
+#include "sctrltp/us_sctp_core.h"
+#include "sctrltp/us_sctp_if.h"
+
+#define NR_FRAMES  (1 << 16)
+/* frames sent by the core test before their echoes are collected (fits into a user rx queue) */
+#define NR_ROUND   512
+/* frames the FPGA model keeps: unacknowledged ones and those held back while its window is full */
+#define NR_PENDING (2 * NR_ROUND)
+
+using namespace sctrltp;
+typedef ParametersFcp P;
+
+static double get_elapsed_time (struct timeval starttime, struct timeval endtime)
+{
+	double diff;
+	diff = ((double)(endtime.tv_sec - starttime.tv_sec)) + ((double)(endtime.tv_usec - starttime.tv_usec))/((double)1000000);
+	return diff;
+}
+
+static void link_name (char *name, size_t len, const char *tag)
+{
+	snprintf (name, len, "hostarq-test-shm-%d-%s", getpid (), tag);
+}
+
+TEST(Shm, exchange)
+{
+	static arq_frame<P> frames[P::TX_BURST], rxbuf[P::RX_BATCH];
+	struct sctp_sock a, b;
+	arq_frame<P> *burst[P::TX_BURST], *bufs[P::RX_BATCH];
+	__u32 len[P::TX_BURST];
+	__s32 nread[P::RX_BATCH];
+	char name[64];
+	__u32 i;
+
+	link_name (name, sizeof(name), "exchange");
+	ASSERT_EQ(shm_init (&a, name, sizeof(arq_frame<P>)), 0);
+	ASSERT_EQ(shm_init (&b, name, sizeof(arq_frame<P>)), 0);
+	for (i = 0; i < P::TX_BURST; i++) {
+		sctpreq_set_header (&frames[i], i, PTYPE_LOOPBACK);
+		sctpreq_set_seq (&frames[i], i);
+		burst[i] = &frames[i];
+		len[i] = sctpreq_get_size (&frames[i]);
+	}
+	for (i = 0; i < P::RX_BATCH; i++)
+		bufs[i] = &rxbuf[i];
+
+	/*both directions, frames arrive in order with their size (padded like UDP datagrams)*/
+	EXPECT_EQ(sock_write_batch (&a, burst, len, P::TX_BURST), (__s32) P::TX_BURST);
+	EXPECT_EQ(sock_read_batch (&b, bufs, nread, P::RX_BATCH), (__s32) P::TX_BURST);
+	for (i = 0; i < P::TX_BURST; i++) {
+		EXPECT_EQ(nread[i], (__s32) ((len[i] < MIN_PACKET_SEND_SIZE) ? MIN_PACKET_SEND_SIZE : len[i]));
+		EXPECT_EQ(sctpreq_get_seq (bufs[i]), i);
+	}
+	EXPECT_EQ(sock_write (&b, burst[3], len[3]), (__s32) len[3]);
+	EXPECT_EQ(sock_read_batch (&a, bufs, nread, P::RX_BATCH), 1);
+	EXPECT_EQ(sctpreq_get_seq (bufs[0]), 3U);
+
+	/*the second endpoint removed the name, a third one starts a new link*/
+	EXPECT_NE(access ((std::string("/dev/shm/") + name).c_str (), F_OK), 0);
+}
+
+TEST(Shm, frame_size_mismatch)
+{
+	struct sctp_sock a, b;
+	char name[64];
+
+	link_name (name, sizeof(name), "mismatch");
+	ASSERT_EQ(shm_init (&a, name, sizeof(arq_frame<P>)), 0);
+	EXPECT_EQ(shm_init (&b, name, sizeof(arq_frame<ParametersAnanasBss1>)), SC_ABORT);
+	shm_unlink (name);
+}
+
+static void *ring_sender (void *arg)
+{
+	static arq_frame<P> frames[P::TX_BURST];
+	struct sctp_sock *sock = (struct sctp_sock *) arg;
+	arq_frame<P> *burst[P::TX_BURST];
+	__u32 len[P::TX_BURST];
+	__u32 i, n;
+
+	for (i = 0; i < P::TX_BURST; i++) {
+		sctpreq_set_header (&frames[i], P::MAX_PDUWORDS, PTYPE_LOOPBACK);
+		burst[i] = &frames[i];
+		len[i] = sctpreq_get_size (&frames[i]);
+	}
+	for (n = 0; n < NR_FRAMES; n += P::TX_BURST) {
+		for (i = 0; i < P::TX_BURST; i++)
+			sctpreq_set_seq (&frames[i], n + i);
+		EXPECT_EQ(sock_write_batch (sock, burst, len, P::TX_BURST), (__s32) P::TX_BURST);
+	}
+	pthread_exit (NULL);
+}
+
+TEST(Shm, full_ring)
+{
+	static arq_frame<P> rxbuf[P::RX_BATCH];
+	struct sctp_sock a, b;
+	struct sctp_stats stats;
+	struct timeval start, end;
+	arq_frame<P> *bufs[P::RX_BATCH];
+	__s32 nread[P::RX_BATCH];
+	__u32 i, received = 0;
+	__s32 ret;
+	pthread_t sendthr;
+	char name[64];
+
+	link_name (name, sizeof(name), "full");
+	ASSERT_EQ(shm_init (&a, name, sizeof(arq_frame<P>)), 0);
+	ASSERT_EQ(shm_init (&b, name, sizeof(arq_frame<P>)), 0);
+	memset (&stats, 0, sizeof(stats));
+	a.stats = &stats;
+	for (i = 0; i < P::RX_BATCH; i++)
+		bufs[i] = &rxbuf[i];
+
+	/*the sender fills the ring and has to wait for the reader*/
+	pthread_create (&sendthr, NULL, ring_sender, &a);
+	usleep (100000);
+	gettimeofday (&start, NULL);
+	while (received < NR_FRAMES) {
+		ret = sock_read_batch (&b, bufs, nread, P::RX_BATCH);
+		ASSERT_GT(ret, 0);
+		for (i = 0; i < (__u32) ret; i++) {
+			EXPECT_EQ(sctpreq_get_seq (bufs[i]), received);
+			received++;
+		}
+	}
+	gettimeofday (&end, NULL);
+	pthread_join (sendthr, NULL);
+
+	EXPECT_EQ(stats.nr_sent, (__u64) NR_FRAMES);
+	EXPECT_GT(stats.nr_tx_blocked, 0ULL);
+	printf ("%.8e frames/s through the ring, sender blocked %llu times\n",
+	        received / get_elapsed_time (start, end), stats.nr_tx_blocked);
+}
+
+/*the model resends its unacknowledged frames after this long without frames from the core (the
+ *core only acknowledges every DELAY_ACK while it has nothing to send, like the FPGA the model
+ *relies on its retransmissions to get the rest of its window acknowledged)*/
+#define MODEL_RTO 2000 /* us */
+
+static __u64 now_us (void)
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return (__u64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/*minimal FPGA: answers the reset with the CFG frame, acknowledges frames in order and echoes
+ *loopback frames (go-back-N, never more than MAX_WINSIZ frames unacknowledged; the link does not
+ *lose frames, so the test only has to keep the user queues open)*/
+static void *fpga_model (void *arg)
+{
+	static arq_frame<P> rxbuf[P::RX_BATCH], txbuf[NR_PENDING];
+	struct sctp_sock *sock = (struct sctp_sock *) arg;
+	arq_frame<P> *bufs[P::RX_BATCH], *burst[P::TX_BURST];
+	struct arq_ackframe ack;
+	__u32 len[P::TX_BURST];
+	__s32 nread[P::RX_BATCH];
+	__u32 i, expected = 0, txseq = 0, rack = P::MAX_NRFRAMES - 1, nburst;
+	__u32 first = 0, npending = 0, nunacked;
+	__u64 last_tx = 0;
+	bool need_ack;
+	__s32 ret;
+
+	for (i = 0; i < P::RX_BATCH; i++)
+		bufs[i] = &rxbuf[i];
+
+	while (1) {
+		/*go back N if the core stays silent (the sent frames stay in txbuf in front of first)*/
+		while (sock->shm.rx->head == sock->shm.rx->tail) {
+			nunacked = (txseq - rack - 1) % P::MAX_NRFRAMES;
+			if ((nunacked > 0) && (now_us () - last_tx > MODEL_RTO)) {
+				for (i = 0; i < nunacked; i++) {
+					burst[0] = &txbuf[(first + NR_PENDING - nunacked + i) % NR_PENDING];
+					sctpreq_set_ack (burst[0], (expected + P::MAX_NRFRAMES - 1) % P::MAX_NRFRAMES);
+					len[0] = sctpreq_get_size (burst[0]);
+					sock_write_batch (sock, burst, len, 1);
+				}
+				last_tx = now_us ();
+			}
+			sched_yield ();
+		}
+		ret = sock_read_batch (sock, bufs, nread, P::RX_BATCH);
+		if (ret < 0)
+			break;
+		need_ack = false;
+		for (i = 0; i < (__u32) ret; i++) {
+			/*reset frames start with the magic word (protocol extensions offered are ignored)*/
+			if (ntohl (bufs[i]->ACK) == HW_HOSTARQ_MAGICWORD) {
+				expected = 0;
+				txseq = 0;
+				rack = P::MAX_NRFRAMES - 1;
+				first = 0;
+				sctpreq_set_header (&txbuf[0], CFG_SIZE, PTYPE_CFG_TYPE);
+				txbuf[0].COMMANDS[0] = htobe64 (P::MAX_NRFRAMES);
+				txbuf[0].COMMANDS[1] = htobe64 (P::MAX_WINSIZ);
+				txbuf[0].COMMANDS[2] = htobe64 (P::MAX_PDUWORDS);
+				npending = 1;
+				continue;
+			}
+			rack = sctpreq_get_ack (bufs[i]);
+			if (nread[i] <= (__s32) sizeof(struct arq_ackframe))
+				continue;
+			need_ack = true;
+			if (sctpreq_get_seq (bufs[i]) != expected)
+				continue;
+			expected = (expected + 1) % P::MAX_NRFRAMES;
+			if (sctpreq_get_typ (bufs[i]) == PTYPE_LOOPBACK) {
+				memcpy (&txbuf[(first + npending) % NR_PENDING], bufs[i], nread[i]);
+				npending++;
+			}
+		}
+
+		/*send what the window allows, every frame carries our ACK*/
+		nburst = 0;
+		while ((npending > 0) && (((txseq - rack - 1) % P::MAX_NRFRAMES) < P::MAX_WINSIZ)) {
+			burst[nburst] = &txbuf[first];
+			first = (first + 1) % NR_PENDING;
+			sctpreq_set_seq (burst[nburst], txseq);
+			sctpreq_set_ack (burst[nburst], (expected + P::MAX_NRFRAMES - 1) % P::MAX_NRFRAMES);
+			len[nburst] = sctpreq_get_size (burst[nburst]);
+			nburst++;
+			txseq = (txseq + 1) % P::MAX_NRFRAMES;
+			npending--;
+			if ((nburst == P::TX_BURST) || (npending == 0)) {
+				sock_write_batch (sock, burst, len, nburst);
+				last_tx = now_us ();
+				nburst = 0;
+				need_ack = false;
+			}
+		}
+		if (nburst > 0) {
+			sock_write_batch (sock, burst, len, nburst);
+			last_tx = now_us ();
+		} else if (need_ack) {
+			sctpack_set_ack (&ack, (expected + P::MAX_NRFRAMES - 1) % P::MAX_NRFRAMES);
+			sock_write (sock, (arq_frame<P> *) &ack, sizeof(ack));
+		}
+	}
+	pthread_exit (NULL);
+}
+
+TEST(Shm, core)
+{
+	static __u64 payload[P::MAX_PDUWORDS], resp[P::MAX_PDUWORDS];
+	struct sctp_sock model;
+	struct sctp_descr<P> *desc;
+	struct timeval start, end;
+	char name[64], addr[80], corename[80];
+	__u32 n, i, received = 0;
+	__u16 typ, num;
+	pthread_t modelthr;
+
+	link_name (name, sizeof(name), "core");
+	snprintf (addr, sizeof(addr), SHM_ADDR_PREFIX "%s", name);
+	snprintf (corename, sizeof(corename), "%s-core", name);
+
+	/*the model creates the link, the core attaches as second endpoint*/
+	ASSERT_EQ(shm_init (&model, name, sizeof(arq_frame<P>)), 0);
+	pthread_create (&modelthr, NULL, fpga_model, &model);
+	pthread_detach (modelthr);
+	ASSERT_EQ(SCTP_CoreUp<P> (corename, addr, 0, 0, 0, 1, NULL, 0), 1);
+
+	desc = SCTP_Open<P> (corename);
+	ASSERT_TRUE(desc != NULL);
+	gettimeofday (&start, NULL);
+	for (n = 0; n < NR_FRAMES; n += NR_ROUND) {
+		for (i = 0; i < NR_ROUND; i++) {
+			payload[0] = n + i;
+			ASSERT_EQ(SCTP_Send<P> (desc, PTYPE_LOOPBACK, P::MAX_PDUWORDS, payload), (__s64) P::MAX_PDUWORDS);
+		}
+		i = 0;
+		while (i < NR_ROUND) {
+			ASSERT_EQ(SCTP_Recv<P> (desc, &typ, &num, resp), 0);
+			/*the answer to the reset comes first*/
+			if (typ == PTYPE_CFG_TYPE)
+				continue;
+			EXPECT_EQ(typ, PTYPE_LOOPBACK);
+			EXPECT_EQ(num, P::MAX_PDUWORDS);
+			EXPECT_EQ(resp[0], (__u64) (n + i));
+			i++;
+			received++;
+		}
+	}
+	gettimeofday (&end, NULL);
+
+	printf ("%u of %u frames echoed\n", received, NR_FRAMES);
+	printf ("%.8e frames/s through core and memory link (%.3f MB/s payload each way)\n",
+	        received / get_elapsed_time (start, end),
+	        1e-6 * received * P::MAX_PDUWORDS * sizeof(__u64) / get_elapsed_time (start, end));
+	EXPECT_EQ(received, (__u32) NR_FRAMES);
+	SCTP_Close<P> (desc);
+	/*the core runs until the process exits, only its name is removed*/
+	shm_unlink (corename);
+}
@@ -0,0 +1,318 @@
+/*Benchmarks the socket layer: one syscall per frame vs. batched sends vs. segmentation offload (WITH_UDP_GSO)
+ * and batched reads vs. receive offload (WITH_UDP_GRO, loopback only)
+ *
+ * Frames are sent to 127.0.0.1 (drained by a local thread) by default. To measure on a veth pair set
+ * HOSTARQ_TEST_REMOTE_IP to the peer address and drain the data port there, e.g.:
+ *   ip netns add peer && ip link add veth0 type veth peer name veth1 netns peer
+ *   ip addr add 10.23.0.1/24 dev veth0 && ip link set veth0 up
+ *   ip -n peer addr add 10.23.0.2/24 dev veth1 && ip -n peer link set veth1 up
+ *   ip netns exec peer socat -u UDP-RECV:45000 /dev/null &
+ *   HOSTARQ_TEST_REMOTE_IP=10.23.0.2 hostarq_test_sock
+ * (WITH_AF_XDP needs this setup, on loopback the backend falls back to the UDP socket)*/
+
+#include "sctrltp/build-config.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+
+#include <gtest/gtest.h>
+
+#include "sctrltp/us_sctp_defs.h"
+#include "sctrltp/us_sctp_sock.h"
+
+#define DATA_PORT  45000
+#define RESET_PORT 45001
+#define RECV_PORT  45002
+#define NR_FRAMES  (1 << 18)
+
+using namespace sctrltp;
+typedef ParametersFcp P;
+
+enum send_mode {
+	PER_FRAME,
+	BATCH,
+	GSO
+};
+
+static arq_frame<P> frames[P::TX_BURST];
+static volatile __s32 drain_stop;
+static volatile __u64 drained;
+static __u64 drained_bad;         /*datagrams drained which are not exactly one frame*/
+static __u32 drain_len;           /*length of a frame*/
+static volatile __s32 sender_done;
+static volatile __u32 consumed;   /*frames recv_frames took from the socket*/
+static __u32 rx_window;           /*frames the receive buffer holds for sure, the sender keeps within*/
+
+static double get_elapsed_time (struct timeval starttime, struct timeval endtime)
+{
+	double diff;
+	diff = ((double)(endtime.tv_sec - starttime.tv_sec)) + ((double)(endtime.tv_usec - starttime.tv_usec))/((double)1000000);
+	return diff;
+}
+
+static void *drain (void *arg)
+{
+	__s32 sd = *((__s32 *) arg);
+	arq_frame<P> buf;
+	ssize_t len;
+
+	while (!drain_stop) {
+		/*the full length of the datagram, even if it does not fit (unsegmented GSO send)*/
+		if ((len = recv (sd, &buf, sizeof(buf), MSG_TRUNC)) > 0) {
+			if (len != drain_len)
+				drained_bad++;
+			drained++;
+		}
+	}
+	pthread_exit (NULL);
+}
+
+/*sends NR_FRAMES full frames in bursts of TX_BURST, returns frames/s*/
+static double send_frames (enum send_mode mode, struct sctp_stats *stats)
+{
+	struct sctp_sock sock;
+	struct sockaddr_in addr;
+	struct timeval start, end, tmo;
+	arq_frame<P> *burst[P::TX_BURST];
+	__u32 len[P::TX_BURST];
+	__u32 rip, i, n;
+	__s32 sd = -1, ret;
+	__u64 window = ~0ULL;
+	int rcvbuf;
+	socklen_t optlen = sizeof(rcvbuf);
+	pthread_t drainthr;
+	const char *remote = getenv ("HOSTARQ_TEST_REMOTE_IP");
+	bool local = (remote == NULL);
+
+	rip = inet_addr (local ? "127.0.0.1" : remote);
+	for (i = 0; i < P::TX_BURST; i++) {
+		sctpreq_set_header (&frames[i], P::MAX_PDUWORDS, 0x8001);
+		burst[i] = &frames[i];
+		len[i] = sctpreq_get_size (&frames[i]);
+	}
+
+	if (local) {
+		sd = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		EXPECT_GE(sd, 0);
+		/*beyond rmem_max, if permitted (see recv_frames)*/
+		rcvbuf = 64 * 1024 * 1024;
+		if (setsockopt (sd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+			setsockopt (sd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+		EXPECT_EQ(getsockopt (sd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &optlen), 0);
+		window = rcvbuf / (4 * sizeof(arq_frame<P>));
+		if (window < P::TX_BURST)
+			window = P::TX_BURST;
+		tmo.tv_sec = 0;
+		tmo.tv_usec = 100000;
+		setsockopt (sd, SOL_SOCKET, SO_RCVTIMEO, &tmo, sizeof(tmo));
+		memset (&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(DATA_PORT);
+		addr.sin_addr.s_addr = rip;
+		EXPECT_EQ(bind (sd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+		drain_stop = 0;
+		drained = 0;
+		drained_bad = 0;
+		drain_len = len[0];
+		pthread_create (&drainthr, NULL, drain, &sd);
+	}
+
+	EXPECT_EQ(sock_init (&sock, &rip, DATA_PORT, RESET_PORT, 0), 0);
+	memset (stats, 0, sizeof(struct sctp_stats));
+	sock.stats = stats;
+#ifdef WITH_UDP_GSO
+	if ((mode == GSO) && !sock.gso)
+		printf ("UDP_SEGMENT not supported, measuring fallback\n");
+	sock.gso = sock.gso && (mode == GSO);
+#endif
+
+	gettimeofday (&start, NULL);
+	for (n = 0; n < NR_FRAMES; n += P::TX_BURST) {
+		/*loopback drops what does not fit into the receive buffer of the drain*/
+		while (n + P::TX_BURST > drained + window)
+			sched_yield ();
+		if (mode == PER_FRAME) {
+			for (i = 0; i < P::TX_BURST; i++) {
+				ret = sock_write (&sock, burst[i], len[i]);
+				EXPECT_EQ(ret, (__s32) len[i]);
+			}
+		} else {
+			ret = sock_write_batch (&sock, burst, len, P::TX_BURST);
+			EXPECT_EQ(ret, (__s32) P::TX_BURST);
+		}
+	}
+	gettimeofday (&end, NULL);
+	close (sock.sd);
+
+	if (local) {
+		/*the drain catches up (a lost datagram ends the wait after a second)*/
+		for (i = 0; (i < 1000) && (drained < stats->nr_sent); i++)
+			usleep (1000);
+		drain_stop = 1;
+		pthread_join (drainthr, NULL);
+		close (sd);
+		printf ("%llu of %u frames drained\n", (unsigned long long) drained, NR_FRAMES);
+		EXPECT_EQ(drained, stats->nr_sent);
+		/*with GSO too, every frame has to arrive as a datagram of its own*/
+		EXPECT_EQ(drained_bad, 0ULL);
+	}
+
+	printf ("#Mode\t#time      \t#Frames/s  \t#Syscalls/frame\n");
+	printf ("%d\t%.8e\t%.8e\t%.4f\n", mode, get_elapsed_time(start, end), NR_FRAMES / get_elapsed_time(start, end),
+	        1.0 * stats->nr_tx_syscalls / stats->nr_sent);
+	return NR_FRAMES / get_elapsed_time(start, end);
+}
+
+TEST(Sock, per_frame)
+{
+	struct sctp_stats stats;
+	EXPECT_GT(send_frames (PER_FRAME, &stats), 0.0);
+	EXPECT_EQ(stats.nr_sent, (__u64) NR_FRAMES);
+	EXPECT_GE(stats.nr_tx_syscalls, stats.nr_sent);
+}
+
+TEST(Sock, batch)
+{
+	struct sctp_stats stats;
+	EXPECT_GT(send_frames (BATCH, &stats), 0.0);
+	EXPECT_EQ(stats.nr_sent, (__u64) NR_FRAMES);
+	EXPECT_LT(stats.nr_tx_syscalls, stats.nr_sent);
+}
+
+#ifdef WITH_UDP_GSO
+TEST(Sock, gso)
+{
+	struct sctp_stats stats;
+	EXPECT_GT(send_frames (GSO, &stats), 0.0);
+	EXPECT_EQ(stats.nr_sent, (__u64) NR_FRAMES);
+	EXPECT_LT(stats.nr_tx_syscalls, stats.nr_sent);
+}
+#endif
+
+static void *sender (void *)
+{
+	struct sctp_sock sock;
+	arq_frame<P> *burst[P::TX_BURST];
+	__u32 len[P::TX_BURST];
+	__u32 rip = inet_addr ("127.0.0.1");
+	__u32 i, n;
+
+	EXPECT_EQ(sock_init (&sock, &rip, RECV_PORT, RESET_PORT, DATA_PORT), 0);
+	for (i = 0; i < P::TX_BURST; i++) {
+		sctpreq_set_header (&frames[i], P::MAX_PDUWORDS, 0x8001);
+		burst[i] = &frames[i];
+		len[i] = sctpreq_get_size (&frames[i]);
+	}
+	for (n = 0; n < NR_FRAMES; n += P::TX_BURST) {
+		/*loopback drops what does not fit into the receive buffer*/
+		while ((__s32)(n + P::TX_BURST - consumed) > (__s32) rx_window)
+			sched_yield ();
+		for (i = 0; i < P::TX_BURST; i++)
+			sctpreq_set_seq (&frames[i], n + i);
+		EXPECT_EQ(sock_write_batch (&sock, burst, len, P::TX_BURST), (__s32) P::TX_BURST);
+	}
+	close (sock.sd);
+	sender_done = 1;
+	pthread_exit (NULL);
+}
+
+/*receives full frames from a local sender (sending in bursts), returns frames/s*/
+static double recv_frames (bool gro)
+{
+	static arq_frame<P> rxbuf[P::RX_BATCH];
+	struct sctp_sock sock;
+	struct timeval start, end;
+	struct pollfd pfd;
+	arq_frame<P> *bufs[P::RX_BATCH];
+	__s32 nread[P::RX_BATCH];
+	__u32 rip = inet_addr ("127.0.0.1");
+	__u32 i, seq, last_seq = 0, reads = 0, received = 0;
+	__s32 ret;
+	int rcvbuf;
+	socklen_t optlen = sizeof(rcvbuf);
+	pthread_t sendthr;
+
+	EXPECT_EQ(sock_init (&sock, &rip, DATA_PORT, RESET_PORT, RECV_PORT), 0);
+	/*beyond rmem_max, if permitted; the kernel reports twice the size, datagrams take up to twice their length*/
+	rcvbuf = 64 * 1024 * 1024;
+	setsockopt (sock.sd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf));
+	EXPECT_EQ(getsockopt (sock.sd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &optlen), 0);
+	rx_window = rcvbuf / (4 * sizeof(arq_frame<P>));
+	if (rx_window < P::TX_BURST)
+		rx_window = P::TX_BURST;
+#ifdef WITH_UDP_GRO
+	if (gro && !sock.gro)
+		printf ("UDP_GRO not supported, measuring fallback\n");
+	if (!gro && sock.gro) {
+		i = 0;
+		setsockopt (sock.sd, SOL_UDP, UDP_GRO, &i, sizeof(i));
+		sock.gro = 0;
+	}
+#else
+	(void) gro;
+#endif
+	for (i = 0; i < P::RX_BATCH; i++)
+		bufs[i] = &rxbuf[i];
+	pfd.fd = sock.sd;
+	pfd.events = POLLIN;
+
+	sender_done = 0;
+	consumed = 0;
+	pthread_create (&sendthr, NULL, sender, NULL);
+
+	while (received < NR_FRAMES) {
+		/*stop, if the sender is done and nothing arrives anymore (lost datagrams)*/
+		if (sender_done && (poll (&pfd, 1, 100) == 0))
+			break;
+		ret = sock_read_batch (&sock, bufs, nread, P::RX_BATCH);
+		if (ret <= 0) {
+			ADD_FAILURE() << "read failed";
+			break;
+		}
+		if (reads++ == 0)
+			gettimeofday (&start, NULL);
+		for (i = 0; i < (__u32) ret; i++) {
+			/*every segment has to end up in its own frame, in order*/
+			EXPECT_EQ(nread[i], (__s32) sctpreq_get_size (bufs[i]));
+			seq = sctpreq_get_seq (bufs[i]);
+			if (received > 0) {
+				EXPECT_GT(seq, last_seq);
+			}
+			last_seq = seq;
+			received++;
+		}
+		consumed = received;
+	}
+	gettimeofday (&end, NULL);
+	/*a sender still waiting for us gives up*/
+	consumed = NR_FRAMES;
+	pthread_join (sendthr, NULL);
+	close (sock.sd);
+
+	printf ("%u of %u frames received\n", received, NR_FRAMES);
+	printf ("#GRO\t#time      \t#Frames/s  \t#Reads/frame\n");
+	printf ("%d\t%.8e\t%.8e\t%.4f\n", gro, get_elapsed_time(start, end), received / get_elapsed_time(start, end),
+	        1.0 * reads / received);
+	EXPECT_EQ(received, (__u32) NR_FRAMES);
+	return received / get_elapsed_time(start, end);
+}
+
+TEST(Sock, receive)
+{
+	EXPECT_GT(recv_frames (false), 0.0);
+}
+
+#ifdef WITH_UDP_GRO
+TEST(Sock, receive_gro)
+{
+	EXPECT_GT(recv_frames (true), 0.0);
+}
+#endif
@@ -0,0 +1,553 @@
+/*Tests loss recovery in the sliding windows (sctp_window.h): the SACK bitmap RX reports for frames
+ *held out of order, TX skipping reported frames when resending, fast retransmissions, resend deadlines,
+ *retransmit bursts limited in size, clocks read before frames were stamped, SEQ wrap around, loss episodes,
+ *what a resend tick, sliding and a lossy window cost for window sizes 32 to 4096, and the congestion
+ *controllers (sctp_cc.h)*/
+
+#include "sctrltp/build-config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <time.h>
+
+#include <gtest/gtest.h>
+
+#include "sctrltp/sctp_window.h"
+
+using namespace sctrltp;
+typedef ParametersFcp P;
+
+static arq_frame<P> *out[P::MAX_NRFRAMES];
+
+TEST(Window, sack_bitmap)
+{
+	static arq_frame<P> frames[P::MAX_WINSIZ];
+	static sctp_window<P> win;
+	arq_frame<P> *in[4];
+	__u64 bitmap[P::SACK_WORDS];
+	__u32 i;
+
+	ASSERT_EQ(win_init<P> (&win, P::MAX_NRFRAMES, P::MAX_WINSIZ, SCTP_RXWIN), 1);
+	for (i = 0; i < P::MAX_WINSIZ; i++)
+		sctpreq_set_seq (&frames[i], i);
+
+	/*nothing held beyond ACK*/
+	in[0] = &frames[0];
+	EXPECT_EQ(new_frames_rx<P> (&win, in, 1, out), 1);
+	EXPECT_EQ(sack_bitmap<P> (&win, 0, bitmap), 0U);
+
+	/*frame 1 is missing, bit i reports frame ACK+1+i*/
+	in[0] = &frames[2];
+	in[1] = &frames[3];
+	in[2] = &frames[70];
+	EXPECT_EQ(new_frames_rx<P> (&win, in, 3, out), 0);
+	EXPECT_EQ(sack_bitmap<P> (&win, 0, bitmap), 3U);
+	EXPECT_EQ(be64toh (bitmap[0]), (1ULL << 1) | (1ULL << 2));
+	EXPECT_EQ(be64toh (bitmap[1]), 1ULL << 5);
+
+	/*the gap is filled, only frame 70 is left out of order*/
+	in[0] = &frames[1];
+	EXPECT_EQ(new_frames_rx<P> (&win, in, 1, out), 3);
+	EXPECT_EQ(sack_bitmap<P> (&win, 3, bitmap), 1U);
+	EXPECT_EQ(be64toh (bitmap[0]), 0ULL);
+	EXPECT_EQ(be64toh (bitmap[1]), 1ULL << 2);
+
+	free (win.frames);
+}
+
+TEST(Window, sack_skips_resend)
+{
+	static arq_frame<P> frames[8];
+	static sctp_window<P> win;
+	sctp_internal<P> resend[P::MAX_NRFRAMES];
+	sctp_internal<P> last;
+	__u64 bitmap[P::SACK_WORDS];
+	__u32 i;
+
+	ASSERT_EQ(win_init<P> (&win, P::MAX_NRFRAMES, P::MAX_WINSIZ, SCTP_TXWIN), 1);
+#ifdef WITH_CONGAV
+	/*no slow start, all frames go out at once*/
+	win.cc.cwnd = P::MAX_WINSIZ;
+#endif
+	for (i = 0; i < 8; i++)
+		ASSERT_EQ(new_frame_tx<P> (&win, &frames[i], 0), 1);
+
+	/*remote holds frames 2..5 but misses 0 and 1 (nothing acknowledged yet)*/
+	memset (bitmap, 0, sizeof(bitmap));
+	bitmap[0] = htobe64 (0x3cULL);
+	EXPECT_EQ(mark_sack<P> (&win, P::MAX_NRFRAMES - 1, bitmap, P::SACK_WORDS), 4U);
+	EXPECT_EQ(mark_sack<P> (&win, P::MAX_NRFRAMES - 1, bitmap, P::SACK_WORDS), 0U);
+
+	ASSERT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 100), 4);
+	EXPECT_EQ(sctpreq_get_seq (resend[0].req), 0U);
+	EXPECT_EQ(sctpreq_get_seq (resend[1].req), 1U);
+	EXPECT_EQ(sctpreq_get_seq (resend[2].req), 6U);
+	EXPECT_EQ(sctpreq_get_seq (resend[3].req), 7U);
+
+	/*the cumulative ACK checks selectively acknowledged frames out like all others*/
+	EXPECT_EQ(mark_frame<P> (&win, 5, out, &last, 0), 6);
+	for (i = 0; i < 6; i++)
+		EXPECT_EQ(out[i], &frames[i]);
+	EXPECT_EQ(last.req, &frames[5]);
+	EXPECT_EQ(last.ntrans, 1U);
+	EXPECT_EQ(last.zc, 0);
+	/*a stale SACK does not touch frames outside the window*/
+	EXPECT_EQ(mark_sack<P> (&win, P::MAX_NRFRAMES - 1, bitmap, P::SACK_WORDS), 0U);
+	EXPECT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 200), 2);
+
+	free (win.frames);
+}
+
+TEST(Window, fast_resend)
+{
+	static arq_frame<P> frames[4];
+	static sctp_window<P> win;
+	sctp_internal<P> resend[P::MAX_NRFRAMES];
+	__u32 i;
+
+	ASSERT_EQ(win_init<P> (&win, P::MAX_NRFRAMES, P::MAX_WINSIZ, SCTP_TXWIN), 1);
+#ifdef WITH_CONGAV
+	win.cc.cwnd = P::MAX_WINSIZ;
+#endif
+	for (i = 0; i < 4; i++)
+		ASSERT_EQ(new_frame_tx<P> (&win, &frames[i], 0), 1);
+
+	/*only frames in window and not acknowledged are resent*/
+	EXPECT_EQ(mark_frame<P> (&win, 0, out, NULL, 0), 1);
+	EXPECT_EQ(fast_resend_frame<P> (&win, 0, resend, 50), 0);
+	EXPECT_EQ(fast_resend_frame<P> (&win, 4, resend, 50), 0);
+	EXPECT_EQ(fast_resend_frame<P> (&win, (__u32) -1, resend, 50), 0);
+	ASSERT_EQ(fast_resend_frame<P> (&win, 1, resend, 50), 1);
+	EXPECT_EQ(resend[0].req, &frames[1]);
+	EXPECT_EQ(resend[0].ntrans, 2U);
+
+	/*the timeout of frame 1 restarted with the fast retransmission*/
+	EXPECT_EQ(resend_deadline<P> (&win, 100), 100U);
+	ASSERT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 100), 2);
+	EXPECT_EQ(resend[0].req, &frames[2]);
+	EXPECT_EQ(resend[1].req, &frames[3]);
+	EXPECT_EQ(resend_deadline<P> (&win, 100), 150U);
+	ASSERT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 150), 1);
+	EXPECT_EQ(resend[0].req, &frames[1]);
+	EXPECT_EQ(resend[0].ntrans, 3U);
+
+	/*frames time out in order of their last transmission, a frame resent now waits a full rto*/
+	EXPECT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 199), 0);
+	ASSERT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 50, 200), 3);
+	EXPECT_EQ(resend[0].req, &frames[2]);
+	EXPECT_EQ(resend[1].req, &frames[3]);
+	EXPECT_EQ(resend[2].req, &frames[1]);
+	EXPECT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 50, 200), 0);
+
+	/*nothing to wait for once all frames are acknowledged*/
+	EXPECT_EQ(ack_pending<P> (&win, 0), 0);
+	EXPECT_EQ(ack_pending<P> (&win, 3), 1);
+	EXPECT_EQ(mark_frame<P> (&win, 3, out, NULL, 200), 3);
+	EXPECT_EQ(ack_pending<P> (&win, 3), 0);
+	EXPECT_EQ(resend_deadline<P> (&win, 50), TIME_NONE);
+
+	free (win.frames);
+}
+
+/*SEQ numbers wrap around at max_frames (a power of 2), the bitmaps of both windows with them*/
+TEST(Window, wrap)
+{
+	static arq_frame<P> frames[128];
+	static sctp_window<P> win;
+	arq_frame<P> *in[64];
+	sctp_internal<P> resend[8];
+	sctp_internal<P> last;
+	__u64 bitmap[P::SACK_WORDS];
+	__u32 i;
+
+	EXPECT_EQ(win_init<P> (&win, 96, 32, SCTP_RXWIN), SC_INVAL);
+
+	/*RXWIN: low_seq moves to 120, frames 122..3 arrive ahead of 120 and 121*/
+	ASSERT_EQ(win_init<P> (&win, 128, 64, SCTP_RXWIN), 1);
+	for (i = 0; i < 128; i++)
+		sctpreq_set_seq (&frames[i], i);
+	for (i = 0; i < 60; i++)
+		in[i] = &frames[i];
+	ASSERT_EQ(new_frames_rx<P> (&win, in, 60, out), 60);
+	for (i = 0; i < 60; i++)
+		in[i] = &frames[60 + i];
+	ASSERT_EQ(new_frames_rx<P> (&win, in, 60, out), 60);
+	for (i = 0; i < 10; i++)
+		in[i] = &frames[(122 + i) % 128];
+	EXPECT_EQ(new_frames_rx<P> (&win, in, 10, out), 0);
+	EXPECT_EQ(sack_bitmap<P> (&win, 119, bitmap), 10U);
+	EXPECT_EQ(be64toh (bitmap[0]), 0xffcULL);
+	EXPECT_EQ(new_frame_rx<P> (&win, &frames[121], out), 0);
+	EXPECT_EQ(new_frame_rx<P> (&win, &frames[120], out), 12);
+	for (i = 0; i < 12; i++)
+		EXPECT_EQ(out[i], &frames[(120 + i) % 128]);
+	EXPECT_EQ(win.low_seq, 4U);
+	EXPECT_EQ(new_frame_rx<P> (&win, &frames[68], out), SC_INVAL);
+	free (win.frames);
+
+	/*TXWIN: frames 124..3 in flight, 126 and 127 selectively acknowledged*/
+	ASSERT_EQ(win_init<P> (&win, 128, 64, SCTP_TXWIN), 1);
+#ifdef WITH_CONGAV
+	win.cc.cwnd = 64;
+#endif
+	for (i = 0; i < 64; i++)
+		ASSERT_EQ(new_frame_tx<P> (&win, &frames[win.high_seq], 0), 1);
+	ASSERT_EQ(mark_frame<P> (&win, 63, out, NULL, 0), 64);
+	for (i = 0; i < 60; i++)
+		ASSERT_EQ(new_frame_tx<P> (&win, &frames[win.high_seq], 0), 1);
+	ASSERT_EQ(mark_frame<P> (&win, 123, out, NULL, 0), 60);
+	for (i = 0; i < 8; i++)
+		ASSERT_EQ(new_frame_tx<P> (&win, &frames[win.high_seq], 0), 1);
+	memset (bitmap, 0, sizeof(bitmap));
+	bitmap[0] = htobe64 (0xcULL);
+	EXPECT_EQ(mark_sack<P> (&win, 123, bitmap, P::SACK_WORDS), 2U);
+
+	/*the ids of zerocopy sends wrap too, the latest one holds all frames checked out*/
+	in[0] = &frames[125];
+	mark_zerocopy<P> (&win, in, 1, 0xfffffffeU);
+	in[0] = &frames[1];
+	mark_zerocopy<P> (&win, in, 1, 1);
+	ASSERT_EQ(mark_frame<P> (&win, 1, out, &last, 0), 6);
+	for (i = 0; i < 6; i++)
+		EXPECT_EQ(out[i], &frames[(124 + i) % 128]);
+	EXPECT_EQ(last.req, &frames[1]);
+	EXPECT_EQ(last.zc, 1);
+	EXPECT_EQ(last.zc_id, 1U);
+	ASSERT_EQ(resend_frame<P> (&win, resend, 8, 100, 100), 2);
+	EXPECT_EQ(resend[0].req, &frames[2]);
+	EXPECT_EQ(resend[1].req, &frames[3]);
+	free (win.frames);
+}
+
+/*A retransmit burst takes the oldest frames first and as many as it is allowed to, frames left over can
+ *get a full timeout again*/
+TEST(Window, resend_limit)
+{
+	static arq_frame<P> frames[8];
+	static sctp_window<P> win;
+	sctp_internal<P> resend[P::MAX_NRFRAMES];
+	__u32 i;
+
+	ASSERT_EQ(win_init<P> (&win, P::MAX_NRFRAMES, P::MAX_WINSIZ, SCTP_TXWIN), 1);
+#ifdef WITH_CONGAV
+	win.cc.cwnd = P::MAX_WINSIZ;
+#endif
+	for (i = 0; i < 8; i++)
+		ASSERT_EQ(new_frame_tx<P> (&win, &frames[i], i), 1);
+
+	ASSERT_EQ(resend_frame<P> (&win, resend, 1, 100, 105), 1);
+	EXPECT_EQ(resend[0].req, &frames[0]);
+	ASSERT_EQ(resend_frame<P> (&win, resend, 2, 100, 105), 2);
+	EXPECT_EQ(resend[0].req, &frames[1]);
+	EXPECT_EQ(resend[1].req, &frames[2]);
+	EXPECT_EQ(resend_deadline<P> (&win, 100), 103U);
+
+	/*frames 3..5 expired but were not resent: they wait a full timeout from now, behind the ones resent*/
+	EXPECT_EQ(resend_restart<P> (&win, 100, 105), 3U);
+	EXPECT_EQ(resend_restart<P> (&win, 100, 105), 0U);
+	EXPECT_EQ(resend_deadline<P> (&win, 100), 106U);
+	ASSERT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 205), 8);
+	EXPECT_EQ(resend[0].req, &frames[6]);
+	EXPECT_EQ(resend[1].req, &frames[7]);
+	EXPECT_EQ(resend[2].req, &frames[0]);
+	EXPECT_EQ(resend[5].req, &frames[3]);
+	EXPECT_EQ(resend[5].ntrans, 2U);
+	EXPECT_EQ(resend[2].ntrans, 3U);
+
+	free (win.frames);
+}
+
+TEST(Window, stale_clock)
+{
+	static arq_frame<P> frames[4];
+	static sctp_window<P> win;
+	sctp_internal<P> resend[P::MAX_NRFRAMES];
+	__u32 i;
+
+	ASSERT_EQ(win_init<P> (&win, P::MAX_NRFRAMES, P::MAX_WINSIZ, SCTP_TXWIN), 1);
+#ifdef WITH_CONGAV
+	win.cc.cwnd = P::MAX_WINSIZ;
+#endif
+	for (i = 0; i < 4; i++)
+		ASSERT_EQ(new_frame_tx<P> (&win, &frames[i], 1000 + i), 1);
+
+	/*a thread read the clock before the frames were stamped: none of them expired*/
+	EXPECT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 500), 0);
+	EXPECT_EQ(resend_restart<P> (&win, 100, 500), 0U);
+	EXPECT_EQ(resend_deadline<P> (&win, 100), 1100U);
+
+	/*an old clock reading does not stamp frame 1 before the others in the resend list*/
+	ASSERT_EQ(fast_resend_frame<P> (&win, 1, resend, 900), 1);
+	EXPECT_EQ(resend_deadline<P> (&win, 100), 1100U);
+	ASSERT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 1102), 2);
+	EXPECT_EQ(resend[0].req, &frames[0]);
+	EXPECT_EQ(resend[1].req, &frames[2]);
+	EXPECT_EQ(resend_deadline<P> (&win, 100), 1103U);
+
+	free (win.frames);
+}
+
+TEST(Window, loss_episode)
+{
+	static arq_frame<P> frames[8];
+	static sctp_window<P> win;
+	sctp_internal<P> resend[P::MAX_NRFRAMES];
+	__u32 i;
+
+	ASSERT_EQ(win_init<P> (&win, P::MAX_NRFRAMES, P::MAX_WINSIZ, SCTP_TXWIN), 1);
+	cc_init (&win.cc, SCTP_CC_CUBIC, P::MAX_WINSIZ);
+	win.cc.cwnd = 10;
+	for (i = 0; i < 8; i++)
+		ASSERT_EQ(new_frame_tx<P> (&win, &frames[i], 0), 1);
+
+	/*the controller hears of the first timeout of an episode only*/
+	ASSERT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 100), 8);
+	EXPECT_EQ(win.flag, 1U);
+	ASSERT_EQ(resend_frame<P> (&win, resend, P::MAX_NRFRAMES, 100, 200), 8);
+#ifdef WITH_CONGAV
+	EXPECT_EQ(win.cc.cwnd, 1U);
+	EXPECT_EQ(win.cc.ssthresh, 7U);
+#endif
+
+	/*the episode ends with the last frame in flight at its start*/
+	EXPECT_EQ(mark_frame<P> (&win, 6, out, NULL, 300), 7);
+	EXPECT_EQ(win.flag, 1U);
+	EXPECT_EQ(mark_frame<P> (&win, 7, out, NULL, 300), 1);
+	EXPECT_EQ(win.flag, 0U);
+
+	free (win.frames);
+}
+
+/*Frames leave and enter a full window every tick (one per tick) but none times out: the ticks should cost
+ *the same for all window sizes*/
+TEST(Window, resend_tick_cost)
+{
+	static sctp_window<P> win;
+	static sctp_internal<P> resend[8192];
+	arq_frame<P> *frames;
+	struct timespec start, end;
+	__u64 currtime = 0, ns;
+	__u32 ws, i, nticks = 20000;
+
+	for (ws = 32; ws <= 4096; ws *= 2) {
+		ASSERT_EQ(win_init<P> (&win, 2 * ws, ws, SCTP_TXWIN), 1);
+#ifdef WITH_CONGAV
+		win.cc.cwnd = ws;
+#endif
+		frames = static_cast<arq_frame<P>*>(calloc (2 * ws, sizeof(arq_frame<P>)));
+		ASSERT_TRUE(frames != NULL);
+		for (i = 0; i < ws; i++)
+			ASSERT_EQ(new_frame_tx<P> (&win, &frames[i], currtime), 1);
+
+		ns = 0;
+		for (i = 0; i < nticks; i++) {
+			currtime += P::TO_RES;
+			ASSERT_EQ(mark_frame<P> (&win, win.low_seq, out, NULL, currtime), 1);
+			ASSERT_EQ(new_frame_tx<P> (&win, &frames[win.high_seq], currtime), 1);
+			clock_gettime (CLOCK_MONOTONIC, &start);
+			ASSERT_EQ(resend_frame<P> (&win, resend, 8192, 2ULL * ws * P::TO_RES, currtime), 0);
+			clock_gettime (CLOCK_MONOTONIC, &end);
+			ns += (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+		}
+		printf ("window %4u frames: %6.1f ns per resend tick\n", ws, (double) ns / nticks);
+
+		free (frames);
+		free (win.frames);
+	}
+}
+
+static __u64 elapsed_ns (struct timespec const *start)
+{
+	struct timespec end;
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) * 1000000000ULL + end.tv_nsec - start->tv_nsec;
+}
+
+/*Frames arrive in order in bursts of P::RX_BATCH (RXWIN) and are acknowledged P::ACK_EVERY at once (TXWIN):
+ *what sliding costs per frame for window sizes 32 to 4096*/
+TEST(Window, slide_cost)
+{
+	static sctp_window<P> win;
+	static arq_frame<P> *out[8192];
+	arq_frame<P> *in[P::RX_BATCH];
+	arq_frame<P> *frames;
+	struct timespec start;
+	__u64 rx_ns, tx_ns, nframes;
+	__u32 ws, i, k, nrounds;
+
+	for (ws = 32; ws <= 4096; ws *= 2) {
+		frames = static_cast<arq_frame<P>*>(calloc (2 * ws, sizeof(arq_frame<P>)));
+		ASSERT_TRUE(frames != NULL);
+		nrounds = (1 << 20) / ws;
+		nframes = (__u64) nrounds * ws;
+
+		ASSERT_EQ(win_init<P> (&win, 2 * ws, ws, SCTP_RXWIN), 1);
+		for (i = 0; i < 2 * ws; i++)
+			sctpreq_set_seq (&frames[i], i);
+		clock_gettime (CLOCK_MONOTONIC, &start);
+		for (i = 0; i < nframes / P::RX_BATCH; i++) {
+			for (k = 0; k < P::RX_BATCH; k++)
+				in[k] = &frames[(win.low_seq + k) & win.mask];
+			ASSERT_EQ(new_frames_rx<P> (&win, in, P::RX_BATCH, out), (__s32) P::RX_BATCH);
+		}
+		rx_ns = elapsed_ns (&start);
+		free (win.frames);
+
+		ASSERT_EQ(win_init<P> (&win, 2 * ws, ws, SCTP_TXWIN), 1);
+#ifdef WITH_CONGAV
+		win.cc.cwnd = ws;
+#endif
+		for (i = 0; i < ws; i++)
+			ASSERT_EQ(new_frame_tx<P> (&win, &frames[i], 0), 1);
+		clock_gettime (CLOCK_MONOTONIC, &start);
+		for (i = 0; i < nframes / P::ACK_EVERY; i++) {
+			ASSERT_EQ(mark_frame<P> (&win, (win.low_seq + P::ACK_EVERY - 1) & win.mask, out, NULL, 0),
+			          (__s32) P::ACK_EVERY);
+			for (k = 0; k < P::ACK_EVERY; k++)
+				ASSERT_EQ(new_frame_tx<P> (&win, out[k], 0), 1);
+		}
+		tx_ns = elapsed_ns (&start);
+		free (win.frames);
+
+		printf ("window %4u frames: %6.1f ns per frame received, %6.1f ns per frame acknowledged\n", ws,
+		        (double) rx_ns / nframes, (double) tx_ns / nframes);
+		free (frames);
+	}
+}
+
+/*Every other frame of a window is lost: RXWIN holds half the window out of order (reported by SACK) until
+ *the gaps are filled, TXWIN learns of them by SACK and resends the others; cost per frame for window sizes
+ *32 to 4096*/
+TEST(Window, loss_cost)
+{
+	static sctp_window<P> win;
+	static arq_frame<P> *out[8192];
+	static sctp_internal<P> resend[8192];
+	arq_frame<P> *in[P::RX_BATCH];
+	arq_frame<P> *frames;
+	struct timespec start;
+	__u64 bitmap[P::SACK_WORDS];
+	__u64 rx_ns, tx_ns, currtime = 0;
+	__u32 ws, i, k, r, pass, base, batch, slides, nrounds;
+
+	for (ws = 32; ws <= 4096; ws *= 2) {
+		frames = static_cast<arq_frame<P>*>(calloc (2 * ws, sizeof(arq_frame<P>)));
+		ASSERT_TRUE(frames != NULL);
+		nrounds = (1 << 20) / ws;
+
+		ASSERT_EQ(win_init<P> (&win, 2 * ws, ws, SCTP_RXWIN), 1);
+		for (i = 0; i < 2 * ws; i++)
+			sctpreq_set_seq (&frames[i], i);
+		clock_gettime (CLOCK_MONOTONIC, &start);
+		batch = (ws / 2 < P::RX_BATCH) ? ws / 2 : P::RX_BATCH;
+		for (r = 0; r < nrounds; r++) {
+			/*odd frames of the window first, then the lost even ones*/
+			base = win.low_seq;
+			slides = 0;
+			for (pass = 0; pass < 2; pass++) {
+				for (i = 0; i < ws / 2; i += batch) {
+					for (k = 0; k < batch; k++)
+						in[k] = &frames[(base + 2 * (i + k) + 1 - pass) & win.mask];
+					slides += new_frames_rx<P> (&win, in, batch, out);
+				}
+				if (pass == 0) {
+					ASSERT_EQ(sack_bitmap<P> (&win, (base - 1) & win.mask, bitmap), ((ws < 128) ? ws : 128) / 2);
+				}
+			}
+			ASSERT_EQ(slides, ws);
+		}
+		rx_ns = elapsed_ns (&start);
+		free (win.frames);
+
+		ASSERT_EQ(win_init<P> (&win, 2 * ws, ws, SCTP_TXWIN), 1);
+		memset (bitmap, 0, sizeof(bitmap));
+		for (i = 0; i < P::SACK_WORDS; i++)
+			bitmap[i] = htobe64 (0xaaaaaaaaaaaaaaaaULL);
+		clock_gettime (CLOCK_MONOTONIC, &start);
+		for (r = 0; r < nrounds; r++) {
+#ifdef WITH_CONGAV
+			win.cc.cwnd = ws;
+#endif
+			for (i = 0; i < ws; i++)
+				ASSERT_EQ(new_frame_tx<P> (&win, &frames[win.high_seq], currtime), 1);
+			currtime += 1000;
+			mark_sack<P> (&win, (win.low_seq - 1) & win.mask, bitmap, P::SACK_WORDS);
+			ASSERT_GE(resend_frame<P> (&win, resend, 8192, 100, currtime), (__s32) ws / 2);
+			ASSERT_EQ(mark_frame<P> (&win, (win.high_seq - 1) & win.mask, out, NULL, currtime), (__s32) ws);
+		}
+		tx_ns = elapsed_ns (&start);
+		free (win.frames);
+
+		printf ("window %4u frames: %6.1f ns per frame received, %6.1f ns per frame acknowledged\n", ws,
+		        (double) rx_ns / ((__u64) nrounds * ws), (double) tx_ns / ((__u64) nrounds * ws));
+		free (frames);
+	}
+}
+
+TEST(Congestion, aimd)
+{
+	struct sctp_cc_state cc;
+	__u32 i;
+
+	ASSERT_EQ(cc_find ("aimd"), SCTP_CC_AIMD);
+	EXPECT_EQ(cc_find ("reno"), SC_INVAL);
+	cc_init (&cc, SCTP_CC_AIMD, 64);
+	EXPECT_EQ(cc.cwnd, 1U);
+	EXPECT_TRUE(cc_can_send (&cc, 0));
+	EXPECT_FALSE(cc_can_send (&cc, 1));
+
+	/*slow start grows by a frame per ACK up to half the window ...*/
+	for (i = 0; i < 31; i++)
+		cc_on_ack (&cc, 4, 0);
+	EXPECT_EQ(cc.cwnd, 32U);
+	/*... then by the free fraction of the window*/
+	cc_on_ack (&cc, 4, 0);
+	EXPECT_EQ(cc.cwnd, 32U);
+	cc_on_ack (&cc, 4, 0);
+	EXPECT_EQ(cc.cwnd, 33U);
+
+	/*a loss lets the window drain and restarts it with one frame*/
+	cc_on_timeout (&cc, 0);
+	EXPECT_EQ(cc.cwnd, 1U);
+	EXPECT_EQ(cc.ssthresh, 16U);
+	EXPECT_FALSE(cc_can_send (&cc, 1));
+}
+
+TEST(Congestion, cubic)
+{
+	struct sctp_cc_state cc;
+	__u64 t = 0, rtt = 1000;
+	__u32 i, j, low;
+
+	ASSERT_EQ(cc_find ("cubic"), SCTP_CC_CUBIC);
+	cc_init (&cc, SCTP_CC_CUBIC, 128);
+	/*slow start until the first loss*/
+	for (i = 0; i < 7; i++)
+		cc_on_ack (&cc, 9, 0);
+	EXPECT_EQ(cc.cwnd, 64U);
+
+	/*a loss takes 30% off, not the whole window*/
+	cc_on_loss (&cc, 0);
+	EXPECT_EQ(cc.cwnd, 44U);
+	EXPECT_TRUE(cc_can_send (&cc, 43));
+
+	/*a window of ACKs per round trip: back at the window of the loss within 60 rounds, never below*/
+	low = cc.cwnd;
+	for (i = 0; i < 60; i++) {
+		t += rtt;
+		for (j = cc.cwnd; j > 0; j--)
+			cc_on_ack (&cc, 1, t);
+		EXPECT_GE(cc.cwnd, low);
+		low = cc.cwnd;
+	}
+	EXPECT_GE(cc.cwnd, 64U);
+	EXPECT_LE(cc.cwnd, 128U);
+
+	/*after a timeout slow start leads back to 70%*/
+	i = cc.cwnd;
+	cc_on_timeout (&cc, t);
+	EXPECT_EQ(cc.cwnd, 1U);
+	EXPECT_EQ(cc.ssthresh, (i * 7) / 10);
+}